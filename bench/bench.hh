@@ -0,0 +1,77 @@
+#ifndef BENCH_HH
+#define BENCH_HH
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace Bench
+{
+
+// contents of the file at path, or size bytes of lines of random words when path is empty
+inline std::string text(std::string const& path, std::size_t const size)
+{
+  if (! path.empty())
+  {
+    std::ifstream ifile {path, std::ios::binary};
+    std::ostringstream res;
+    res << ifile.rdbuf();
+
+    return res.str();
+  }
+
+  std::vector<std::string_view> const words {
+    "the", "of", "and", "a", "to", "in", "he", "said,", "that", "was", "it", "his",
+    "reading", "\"quickly\"", "sentence.", "chapter", "supercalifragilisticexpialidocious-and-more"};
+
+  std::mt19937 rng {12345};
+  std::string res;
+  res.reserve(size + 64);
+
+  while (res.size() < size)
+  {
+    res += words[rng() % words.size()];
+    res += rng() % 12 ? " " : "\n";
+  }
+
+  return res;
+}
+
+// seconds taken by f, the best of count runs
+template<typename F>
+double seconds(F const& f, std::size_t const count = 3)
+{
+  double res {0};
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    auto const begin = std::chrono::steady_clock::now();
+    f();
+    auto const time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (i == 0 || time < res)
+    {
+      res = time;
+    }
+  }
+
+  return res;
+}
+
+inline void report(std::string_view const name, double const val, std::string_view const unit)
+{
+  std::cout << std::left << std::setw(32) << name << std::right << std::setw(12)
+  << std::fixed << std::setprecision(3) << val << " " << unit << "\n";
+}
+
+} // namespace Bench
+
+#endif // BENCH_HH
@@ -0,0 +1,153 @@
+// heap allocations and time per frame in steady state,
+// each frame moving to the next word and drawing the line the way the reader does,
+// a char at a time with interned styles, then rendering the changed cells,
+// the reader itself needs a terminal, so its parts are driven directly
+//
+// usage: bench_frame [file]
+
+#include "bench.hh"
+
+#include "fltrdr/fltrdr.hh"
+#include "fltrdr/screen.hh"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cctype>
+
+#include <new>
+#include <array>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <iostream>
+
+namespace
+{
+
+// number of calls to operator new
+std::size_t allocs {0};
+
+} // namespace
+
+void* operator new(std::size_t const size)
+{
+  ++allocs;
+
+  if (auto* ptr = std::malloc(size ? size : 1))
+  {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t const size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+  auto const str = Bench::text(argc > 1 ? argv[1] : "", std::size_t {1} << 24);
+
+  std::size_t const width {80};
+  std::size_t const height {24};
+  std::size_t const row {height / 2 - 2};
+
+  Fltrdr fltrdr;
+  std::istringstream input {str};
+  fltrdr.parse(input);
+  fltrdr.screen_size(width, height);
+
+  Screen screen;
+  screen.size(width, height);
+
+  // styles of plain chars, the current word, its focus char, and punctuation
+  std::array<Screen::Style, 4> const styles {
+    screen.style("\x1b[38;2;80;80;80m"),
+    screen.style("\x1b[38;2;250;250;250m"),
+    screen.style("\x1b[38;2;255;0;0m"),
+    screen.style("\x1b[38;2;120;120;120m"),
+  };
+
+  std::string out;
+  out.reserve(1 << 16);
+
+  auto const frame = [&] {
+    if (! fltrdr.next_word())
+    {
+      fltrdr.begin();
+    }
+
+    fltrdr.set_line();
+    auto const& line = fltrdr.get_line();
+
+    screen.erase(0, row);
+    std::size_t x {0};
+
+    auto const draw = [&](std::string const& chars, bool const curr) {
+      for (auto const c : chars)
+      {
+        auto style = styles[curr ? 1 : 0];
+
+        if (curr && x == width / 2 - 1)
+        {
+          style = styles[2];
+        }
+        else if (std::ispunct(static_cast<unsigned char>(c)))
+        {
+          style = styles[3];
+        }
+
+        screen.put(x++, row, std::string_view(&c, 1), style);
+      }
+    };
+
+    draw(line.prev, false);
+    draw(line.curr, true);
+    draw(line.next, false);
+
+    out.clear();
+    screen.render(out);
+  };
+
+  // grow the buffers to their steady state size
+  for (std::size_t i = 0; i < 1000; ++i)
+  {
+    frame();
+  }
+
+  std::size_t const count {100000};
+  auto const before = allocs;
+  auto const time = Bench::seconds([&] {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      frame();
+    }
+  }, 1);
+
+  Bench::report("allocations per frame", static_cast<double>(allocs - before) / count, "");
+  Bench::report("time per frame", time * 1e6 / count, "us");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+// time taken to look up words through the word index,
+// against a plain array of their positions and walking the text to a word
+//
+// usage: bench_index [file]
+
+#include "bench.hh"
+
+#include "fltrdr/text.hh"
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <iostream>
+
+namespace
+{
+
+bool is_space(char const c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// text position of word n found by walking the words of the text from its start
+std::size_t walk(std::string_view const str, std::size_t n)
+{
+  for (std::size_t i = 0; i < str.size();)
+  {
+    while (i < str.size() && is_space(str[i]))
+    {
+      ++i;
+    }
+
+    if (n-- == 0)
+    {
+      return i;
+    }
+
+    while (i < str.size() && ! is_space(str[i]))
+    {
+      ++i;
+    }
+  }
+
+  return str.size();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  auto const str = Bench::text(argc > 1 ? argv[1] : "", std::size_t {1} << 27);
+
+  // no word is split, so that walking the text finds the same words
+  Text text;
+  text.set_width(str.size());
+  text.reserve(str.size());
+
+  {
+    std::istringstream input {str};
+    text.read(input);
+  }
+
+  text.index();
+
+  auto const size = text.size();
+  std::vector<std::size_t> plain (size);
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    plain[i] = text.pos(i);
+  }
+
+  std::cout << "text: " << str.size() << " bytes, " << size << " words\n";
+
+  Bench::report("index size", static_cast<double>(text.index_size()) / static_cast<double>(size), "bytes/word");
+  Bench::report("array size", static_cast<double>(sizeof(std::size_t)), "bytes/word");
+
+  // random words looked up
+  std::size_t const count {1 << 22};
+  std::vector<std::size_t> words (count);
+  std::vector<std::size_t> positions (count);
+  std::mt19937 rng {12345};
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    words[i] = rng() % size;
+    positions[i] = plain[words[i]];
+  }
+
+  // sum of the results, so that the lookups are not optimized out
+  std::size_t sum {0};
+  auto const ns = [&](double const time) { return time * 1e9 / count; };
+
+  Bench::report("index pos, random", ns(Bench::seconds([&] {
+    for (auto const i : words)
+    {
+      sum += text.pos(i);
+    }
+  })), "ns");
+
+  Bench::report("array pos, random", ns(Bench::seconds([&] {
+    for (auto const i : words)
+    {
+      sum += plain[i];
+    }
+  })), "ns");
+
+  Bench::report("index pos, in order", ns(Bench::seconds([&] {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      sum += text.pos(i % size);
+    }
+  })), "ns");
+
+  Bench::report("index count, random", ns(Bench::seconds([&] {
+    for (auto const pos : positions)
+    {
+      sum += text.count(pos);
+    }
+  })), "ns");
+
+  // a jump to the middle of the text the way the reader used to make it
+  std::size_t walked {0};
+  Bench::report("walk to the middle word", Bench::seconds([&] { walked = walk(str, size / 2); }) * 1e3, "ms");
+
+  if (walked != text.pos(size / 2) || sum == 0)
+  {
+    std::cerr << "error: the words found differ\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
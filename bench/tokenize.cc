@@ -0,0 +1,134 @@
+// throughput of finding the words of the text,
+// the whitespace of 64 chars at a time classified with simd,
+// against a scalar loop over each char and the istream operator>> of the old parser
+//
+// usage: bench_tokenize [file]
+
+#include "bench.hh"
+
+#include "fltrdr/text.hh"
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+
+// max word size, longer words are split
+std::size_t const width {20};
+
+bool is_space(char const c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// text positions of the words, a char at a time
+std::vector<std::size_t> scalar(std::string_view const str)
+{
+  std::vector<std::size_t> res;
+
+  for (std::size_t i = 0; i < str.size();)
+  {
+    if (is_space(str[i]))
+    {
+      ++i;
+
+      continue;
+    }
+
+    auto const begin = i;
+
+    while (i < str.size() && ! is_space(str[i]))
+    {
+      ++i;
+    }
+
+    for (auto pos = begin; pos < i; pos += width)
+    {
+      res.emplace_back(pos);
+    }
+  }
+
+  return res;
+}
+
+// number of words read by the old parser
+std::size_t stream(std::string const& str)
+{
+  std::istringstream input {str};
+  std::string word;
+  std::size_t res {0};
+
+  while (input >> std::ws >> word)
+  {
+    res += (word.size() + width - 1) / width;
+  }
+
+  return res;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  auto const str = Bench::text(argc > 1 ? argv[1] : "", std::size_t {1} << 27);
+  auto const gb = static_cast<double>(str.size()) / 1e9;
+
+  std::cout << "text: " << str.size() << " bytes, threads: " << std::thread::hardware_concurrency() << "\n";
+
+  // the whole text indexed at once, split over all cores
+  Text text;
+  text.set_width(width);
+  text.reserve(str.size());
+
+  {
+    std::istringstream input {str};
+    text.read(input);
+  }
+
+  Bench::report("index, all threads", gb / Bench::seconds([&] { text.index(); }), "GB/s");
+
+  // the text appended a piece at a time, as when streamed, on one thread
+  Bench::report("append, one thread", gb / Bench::seconds([&] {
+    Text part;
+    part.set_width(width);
+    part.reserve(str.size());
+
+    for (std::size_t i = 0; i < str.size(); i += 1 << 20)
+    {
+      part.append(std::string_view(str).substr(i, 1 << 20));
+    }
+
+    part.finish();
+  }), "GB/s");
+
+  std::vector<std::size_t> ref;
+  Bench::report("scalar, one thread", gb / Bench::seconds([&] { ref = scalar(str); }), "GB/s");
+
+  std::size_t count {0};
+  Bench::report("istream, one thread", gb / Bench::seconds([&] { count = stream(str); }, 1), "GB/s");
+
+  // every path finds the same words
+  bool same {text.size() == ref.size() && count == ref.size()};
+
+  for (std::size_t i = 0; same && i < ref.size(); ++i)
+  {
+    same = text.pos(i) == ref[i];
+  }
+
+  if (! same)
+  {
+    std::cerr << "error: the words found differ\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,360 @@
+#include "fltrdr/decoder.hh"
+
+#if defined(FLTRDR_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(FLTRDR_LZMA)
+#include <lzma.h>
+#endif
+
+#if defined(FLTRDR_ZSTD)
+#include <zstd.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+struct Decoder::State
+{
+#if defined(FLTRDR_ZLIB)
+  z_stream gzip {};
+#endif
+
+#if defined(FLTRDR_LZMA)
+  lzma_stream xz = LZMA_STREAM_INIT;
+#endif
+
+#if defined(FLTRDR_ZSTD)
+  ZSTD_DStream* zstd {nullptr};
+
+  // the last call did not finish a frame
+  bool zstd_partial {false};
+#endif
+};
+
+Decoder::Type Decoder::detect(std::string_view const head)
+{
+  if (head.substr(0, 2) == std::string_view("\x1f\x8b", 2))
+  {
+    return Type::gzip;
+  }
+
+  if (head.substr(0, 6) == std::string_view("\xfd" "7zXZ\x00", 6))
+  {
+    return Type::xz;
+  }
+
+  if (head.substr(0, 4) == std::string_view("\x28\xb5\x2f\xfd", 4))
+  {
+    return Type::zstd;
+  }
+
+  return Type::none;
+}
+
+bool Decoder::supported(Type const type)
+{
+  switch (type)
+  {
+    case Type::none:
+      return true;
+
+    case Type::gzip:
+#if defined(FLTRDR_ZLIB)
+      return true;
+#else
+      return false;
+#endif
+
+    case Type::xz:
+#if defined(FLTRDR_LZMA)
+      return true;
+#else
+      return false;
+#endif
+
+    case Type::zstd:
+#if defined(FLTRDR_ZSTD)
+      return true;
+#else
+      return false;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+Decoder::Decoder()
+{
+  _ctx.state = std::make_unique<State>();
+}
+
+Decoder::~Decoder()
+{
+  reset();
+}
+
+void Decoder::reset()
+{
+  switch (_ctx.type)
+  {
+#if defined(FLTRDR_ZLIB)
+    case Type::gzip:
+      inflateEnd(&_ctx.state->gzip);
+      break;
+#endif
+
+#if defined(FLTRDR_LZMA)
+    case Type::xz:
+      lzma_end(&_ctx.state->xz);
+      break;
+#endif
+
+#if defined(FLTRDR_ZSTD)
+    case Type::zstd:
+      ZSTD_freeDStream(_ctx.state->zstd);
+      break;
+#endif
+
+    default:
+      break;
+  }
+
+  _ctx.type = Type::none;
+  _ctx.state = std::make_unique<State>();
+}
+
+bool Decoder::init(Type const type)
+{
+  reset();
+
+  if (! supported(type))
+  {
+    return false;
+  }
+
+  switch (type)
+  {
+#if defined(FLTRDR_ZLIB)
+    case Type::gzip:
+    {
+      // max window size with gzip header decoding
+      if (inflateInit2(&_ctx.state->gzip, 15 + 16) != Z_OK)
+      {
+        return false;
+      }
+
+      break;
+    }
+#endif
+
+#if defined(FLTRDR_LZMA)
+    case Type::xz:
+    {
+      if (lzma_stream_decoder(&_ctx.state->xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+      {
+        return false;
+      }
+
+      break;
+    }
+#endif
+
+#if defined(FLTRDR_ZSTD)
+    case Type::zstd:
+    {
+      _ctx.state->zstd = ZSTD_createDStream();
+      if (! _ctx.state->zstd)
+      {
+        return false;
+      }
+
+      break;
+    }
+#endif
+
+    default:
+      break;
+  }
+
+  _ctx.type = type;
+
+  return true;
+}
+
+bool Decoder::write(std::string_view const in, std::string& out)
+{
+  switch (_ctx.type)
+  {
+    case Type::none:
+    {
+      out.append(in);
+
+      return true;
+    }
+
+#if defined(FLTRDR_ZLIB)
+    case Type::gzip:
+    {
+      auto& strm = _ctx.state->gzip;
+      strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+      strm.avail_in = static_cast<uInt>(in.size());
+
+      // keep going while there is input left or the output filled the buffer
+      do
+      {
+        auto const size = out.size();
+        out.resize(size + _ctx.buf_size);
+        strm.next_out = reinterpret_cast<Bytef*>(out.data() + size);
+        strm.avail_out = static_cast<uInt>(_ctx.buf_size);
+
+        auto const ec = inflate(&strm, Z_NO_FLUSH);
+        out.resize(out.size() - strm.avail_out);
+
+        if (ec == Z_STREAM_END)
+        {
+          // a gzip file may hold several members one after another
+          inflateReset(&strm);
+        }
+        else if (ec != Z_OK && ec != Z_BUF_ERROR)
+        {
+          return false;
+        }
+      }
+      while (strm.avail_in || strm.avail_out == 0);
+
+      return true;
+    }
+#endif
+
+#if defined(FLTRDR_LZMA)
+    case Type::xz:
+    {
+      auto& strm = _ctx.state->xz;
+      strm.next_in = reinterpret_cast<std::uint8_t const*>(in.data());
+      strm.avail_in = in.size();
+
+      // keep going while there is input left or the output filled the buffer
+      do
+      {
+        auto const size = out.size();
+        out.resize(size + _ctx.buf_size);
+        strm.next_out = reinterpret_cast<std::uint8_t*>(out.data() + size);
+        strm.avail_out = _ctx.buf_size;
+
+        auto const ec = lzma_code(&strm, LZMA_RUN);
+        out.resize(out.size() - strm.avail_out);
+
+        if (ec != LZMA_OK && ec != LZMA_STREAM_END && ec != LZMA_BUF_ERROR)
+        {
+          return false;
+        }
+      }
+      while (strm.avail_in || strm.avail_out == 0);
+
+      return true;
+    }
+#endif
+
+#if defined(FLTRDR_ZSTD)
+    case Type::zstd:
+    {
+      ZSTD_inBuffer ibuf {in.data(), in.size(), 0};
+      bool full {false};
+
+      // keep going while there is input left or the output filled the buffer
+      do
+      {
+        auto const size = out.size();
+        out.resize(size + _ctx.buf_size);
+        ZSTD_outBuffer obuf {out.data() + size, _ctx.buf_size, 0};
+
+        auto const ec = ZSTD_decompressStream(_ctx.state->zstd, &obuf, &ibuf);
+        out.resize(size + obuf.pos);
+
+        if (ZSTD_isError(ec))
+        {
+          return false;
+        }
+
+        _ctx.state->zstd_partial = ec != 0;
+        full = obuf.pos == obuf.size;
+      }
+      while (ibuf.pos < ibuf.size || full);
+
+      return true;
+    }
+#endif
+
+    default:
+      return false;
+  }
+}
+
+bool Decoder::finish(std::string& out)
+{
+  switch (_ctx.type)
+  {
+    case Type::none:
+    {
+      return true;
+    }
+
+#if defined(FLTRDR_ZLIB)
+    case Type::gzip:
+    {
+      // all output is produced as the input is written,
+      // a stream reset after its end has no header read yet
+      auto& strm = _ctx.state->gzip;
+
+      return strm.total_in == 0;
+    }
+#endif
+
+#if defined(FLTRDR_LZMA)
+    case Type::xz:
+    {
+      auto& strm = _ctx.state->xz;
+      strm.next_in = nullptr;
+      strm.avail_in = 0;
+
+      while (true)
+      {
+        auto const size = out.size();
+        out.resize(size + _ctx.buf_size);
+        strm.next_out = reinterpret_cast<std::uint8_t*>(out.data() + size);
+        strm.avail_out = _ctx.buf_size;
+
+        auto const ec = lzma_code(&strm, LZMA_FINISH);
+        out.resize(out.size() - strm.avail_out);
+
+        if (ec == LZMA_STREAM_END)
+        {
+          return true;
+        }
+
+        if (ec != LZMA_OK)
+        {
+          return false;
+        }
+      }
+    }
+#endif
+
+#if defined(FLTRDR_ZSTD)
+    case Type::zstd:
+    {
+      return ! _ctx.state->zstd_partial;
+    }
+#endif
+
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef DECODER_HH
+#define DECODER_HH
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+// streaming decompression of gzip, xz, and zstd data
+class Decoder
+{
+public:
+
+  enum class Type
+  {
+    none,
+    gzip,
+    xz,
+    zstd,
+  };
+
+  // number of leading bytes needed to detect the compression type
+  static constexpr std::size_t magic_size {6};
+
+  // compression type of data starting with head
+  static Type detect(std::string_view const head);
+
+  // whether support for the compression type was built in
+  static bool supported(Type const type);
+
+  Decoder();
+  Decoder(Decoder const&) = delete;
+  Decoder& operator=(Decoder const&) = delete;
+  ~Decoder();
+
+  // start decompressing data of the compression type,
+  // returns false if the compression type is not supported
+  bool init(Type const type);
+
+  // decompress the next piece of data, appending the output to out,
+  // returns false if the data is corrupt
+  bool write(std::string_view const in, std::string& out);
+
+  // flush the remaining output once there is no more data,
+  // returns false if the data ended in the middle of a stream
+  bool finish(std::string& out);
+
+private:
+
+  void reset();
+
+  // decompression state of the library in use
+  struct State;
+
+  struct Ctx
+  {
+    Type type {Type::none};
+    std::unique_ptr<State> state;
+
+    // output is produced in pieces of this size
+    std::size_t const buf_size {65536};
+  } _ctx;
+};
+
+#endif // DECODER_HH
@@ -22,11 +22,36 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <regex>
 #include <iterator>
 #include <random>
+#include <functional>
+#include <system_error>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <tuple>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Fltrdr::~Fltrdr()
+{
+  search_stop();
+  stream_stop();
+}
 
 void Fltrdr::init()
 {
+  search_stop();
+  stream_stop();
   _ctx.text.clear();
-  _ctx.text.shrink_to_fit();
+  _ctx.text.set_width(_ctx.width_min);
+  _ctx.lexicon.clear();
+  _ctx.cache.clear();
+  _ctx.layout = {};
 
   _ctx.pos = 0;
   _ctx.index = 1;
@@ -34,432 +59,898 @@ void Fltrdr::init()
   _ctx.wpm_count = 0;
   _ctx.wpm_total = 0;
   _ctx.slow = false;
-  _ctx.search.it = std::sregex_iterator();
+  matches_clear();
+  _ctx.search.active = false;
+  _ctx.search.jump = false;
 }
 
 bool Fltrdr::parse(std::istream& input)
 {
   init();
 
-  std::string word;
-  std::size_t word_count {0};
-  while (input >> std::ws >> word)
+  _ctx.text.read(input);
+
+  return index();
+}
+
+bool Fltrdr::open(std::string const& path)
+{
+  init();
+
+  // decompress compressed files in the background as they are read
+  if (auto const type = compression(path); type != Decoder::Type::none)
   {
-    while (word.size() > _ctx.width_min)
+    if (! Decoder::supported(type))
     {
-      _ctx.text += " " + word.substr(0, _ctx.width_min);
-      word.erase(0, _ctx.width_min);
-      ++word_count;
+      throw std::runtime_error("no support for the compression of the file '" + path + "'");
     }
 
-    if (! word.empty())
+    int const fd {::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd == -1)
     {
-      _ctx.text += " " + word;
-      ++word_count;
+      throw std::runtime_error("could not open the file '" + path + "'");
     }
+
+    return stream(fd);
   }
 
-  if (word_count == 0)
+  // map the file in place, falling back to reading it into memory
+  // when it can not be mapped, such as with an empty file or a pipe
+  if (_ctx.text.map(path))
   {
-    _ctx.text = " fltrdr";
-    ++word_count;
-    _ctx.index_max = word_count;
-    return false;
-  }
+    auto const cache = cache_file(path);
+    _ctx.cache = cache;
 
-  _ctx.index_max = word_count;
-  return true;
-}
+    // reuse the word index saved from a previous open of the unchanged file
+    if (_ctx.text.load(cache))
+    {
+      cache_touch(cache);
+      _ctx.index_max = _ctx.text.size();
+      _ctx.pos = _ctx.text.pos(_ctx.index - 1);
+      lexicon();
 
-bool Fltrdr::eof()
-{
-  return _ctx.index >= _ctx.index_max;
-}
+      return true;
+    }
 
-void Fltrdr::begin()
-{
-  set_index(_ctx.index_min);
-}
+    if (! index())
+    {
+      return false;
+    }
 
-void Fltrdr::end()
-{
-  set_index(_ctx.index_max);
-}
+    _ctx.text.save(cache);
+    cache_prune();
 
-Fltrdr& Fltrdr::screen_size(std::size_t const width, std::size_t const height)
-{
-  _ctx.width = width;
-  _ctx.height = height;
+    return true;
+  }
+  else
+  {
+    std::ifstream ifile {path};
+    if (! ifile.is_open())
+    {
+      throw std::runtime_error("could not open the file '" + path + "'");
+    }
 
-  return *this;
-}
+    std::error_code ec;
+    auto const size = fs::file_size(path, ec);
+    if (! ec)
+    {
+      _ctx.text.reserve(size);
+    }
 
-std::string Fltrdr::buf_prev(std::size_t offset)
-{
-  if (! _ctx.pos)
-  {
-    return {};
+    _ctx.text.read(ifile);
   }
 
-  auto const width = (_ctx.width / 2) - 1 - offset;
+  return index();
+}
 
-  auto pos = _ctx.pos + 1;
-  int size {static_cast<int>(width - _ctx.focus_point)};
-  auto count = size;
+bool Fltrdr::stream(int const fd)
+{
+  init();
 
-  while (pos && count)
+  if (fd == -1)
   {
-    --pos;
-    --count;
+    return index();
   }
 
-  size = size - count;
-  if (size < 1)
+  // size the text for a redirected file
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
   {
-    return {};
+    _ctx.text.reserve(static_cast<std::size_t>(st.st_size));
   }
 
-  auto const min = pos;
+  _ctx.stream.fd = fd;
+  _ctx.stream.stop = false;
+  _ctx.stream.done = false;
+  _ctx.stream.open = true;
+  _ctx.stream.thread = std::thread(&Fltrdr::stream_read, this);
 
-  if (_ctx.show_line)
+  // wait until there are enough words to render the first frame
+  while (_ctx.stream.open && _ctx.text.size() < _ctx.stream.words_min)
   {
-    return _ctx.text.substr(min, static_cast<std::size_t>(size));
-  }
+    {
+      std::unique_lock<std::mutex> lock {_ctx.stream.mutex};
+      _ctx.stream.cv.wait(lock, [&] {
+        return ! _ctx.stream.chunks.empty() || _ctx.stream.done;
+      });
+    }
 
-  pos = _ctx.pos;
+    update();
+  }
 
-  for (int i = 0; i < _ctx.show_prev; ++i)
+  if (_ctx.text.size() == 0)
   {
-    pos = _ctx.text.rfind(" ", --pos);
-
-    if (pos == std::string::npos || pos == 0)
-    {
-      break;
-    }
+    return index();
   }
 
-  auto const start = pos > min ? pos : min;
-  auto const len = _ctx.pos + 1 - start < static_cast<std::size_t>(size) ?
-    _ctx.pos + 1 - start : static_cast<std::size_t>(size);
-  return _ctx.text.substr(start, len);
+  return true;
 }
 
-std::string Fltrdr::buf_next(std::size_t offset)
+void Fltrdr::stream_read()
 {
-  auto pos = _ctx.text.find(" ", _ctx.pos + 1);
-  auto const start = pos;
-
-  if (pos == std::string::npos)
-  {
-    return {};
-  }
-
-  auto const width = (_ctx.width / 2) + 1 + offset;
+  pollfd pfd {_ctx.stream.fd, POLLIN, 0};
+  std::string buf;
 
-  auto p = pos;
-  int size {static_cast<int>(width - (_ctx.word.size() - _ctx.focus_point))};
+  // leading bytes held back until the compression type is known
+  std::string head;
+  bool detected {false};
+  bool compressed {false};
+  Decoder decoder;
 
-  if (_ctx.width % 2 != 0)
+  auto const push = [&](std::string&& str)
   {
-    ++size;
-  }
+    if (str.empty())
+    {
+      return;
+    }
 
-  auto count = size;
+    {
+      std::lock_guard<std::mutex> lock {_ctx.stream.mutex};
+      _ctx.stream.chunks.emplace_back(std::move(str));
+    }
+    _ctx.stream.cv.notify_one();
+  };
 
-  if (size < 1)
+  // decompress the data when compressed, then hand it to the ui thread
+  auto const write = [&](std::string&& str)
   {
-    return {};
-  }
+    if (! detected)
+    {
+      detected = true;
+      auto const type = Decoder::detect(str);
+      compressed = type != Decoder::Type::none;
 
-  while (++count != size && ++p != _ctx.text.size() - 1);
+      if (compressed && ! decoder.init(type))
+      {
+        return false;
+      }
+    }
 
-  auto const max = static_cast<std::size_t>(size);
+    if (! compressed)
+    {
+      push(std::move(str));
+      return true;
+    }
 
-  if (_ctx.show_line)
-  {
-    return _ctx.text.substr(pos, max);
-  }
+    std::string out;
+    bool const res {decoder.write(str, out)};
+    push(std::move(out));
 
-  for (int i = 0; i < _ctx.show_next; ++i)
+    return res;
+  };
+
+  while (! _ctx.stream.stop)
   {
-    pos = _ctx.text.find(" ", ++pos);
+    // wake up periodically to check if the reader should stop
+    int const ec {poll(&pfd, 1, 100)};
 
-    if (pos == std::string::npos)
+    if (ec == 0 || (ec == -1 && errno == EINTR))
     {
-      pos = _ctx.text.size() - 1;
+      continue;
+    }
 
+    if (ec == -1)
+    {
       break;
     }
-  }
 
-  auto const end = pos - start + 1;
-  return _ctx.text.substr(start, end > max ? max : end);
-}
+    buf.resize(65536);
+    auto const num = read(_ctx.stream.fd, buf.data(), buf.size());
 
-void Fltrdr::set_focus_point()
-{
-  std::size_t begin {0};
-  std::size_t end {_ctx.word.size()};
+    if (num == -1 && (errno == EINTR || errno == EAGAIN))
+    {
+      continue;
+    }
 
-  // check for punct at beginning of word
-  for (auto i = _ctx.word.begin(); i != _ctx.word.end(); ++i)
-  {
-    if (std::isalpha(static_cast<unsigned char>(*i)) != 0)
+    if (num <= 0)
     {
       break;
     }
 
-    ++begin;
-  }
+    buf.resize(static_cast<std::size_t>(num));
 
-  // check for punct at end of word
-  for (auto i = _ctx.word.rbegin(); i != _ctx.word.rend(); ++i)
-  {
-    if (std::isalpha(static_cast<unsigned char>(*i)) != 0)
+    if (! detected && head.size() + buf.size() < Decoder::magic_size)
     {
-      if (*i == 's' && ++i != _ctx.word.rend() && *i == '\'')
-      {
-        end -= 2;
-      }
+      head += buf;
+      buf = {};
+      continue;
+    }
 
+    if (! head.empty())
+    {
+      buf.insert(0, head);
+      head.clear();
+    }
+
+    if (! write(std::move(buf)))
+    {
       break;
     }
 
-    --end;
+    buf = {};
   }
 
-  auto size {end - begin};
-  if (size > _ctx.word.size() || size == 0)
+  // the data ended before the compression type could be detected
+  if (! head.empty())
   {
-    size = _ctx.word.size();
+    write(std::move(head));
   }
 
-  if (size < 13)
-  {
-    _ctx.focus_point = std::round(size * _ctx.focus);
-  }
-  else
+  if (compressed && ! _ctx.stream.stop)
   {
-    _ctx.focus_point = 3;
+    std::string out;
+    decoder.finish(out);
+    push(std::move(out));
   }
 
-  if (_ctx.word.size() != size)
   {
-    _ctx.focus_point += begin;
+    std::lock_guard<std::mutex> lock {_ctx.stream.mutex};
+    _ctx.stream.done = true;
   }
+  _ctx.stream.cv.notify_one();
 }
 
-void Fltrdr::set_line(std::size_t offset)
+void Fltrdr::stream_stop()
 {
-  _ctx.line = {};
-  current_word();
-  set_focus_point();
-
-  if (_ctx.show_line)
-  {
-    _ctx.line.prev = buf_prev(offset);
-    _ctx.line.next = buf_next(offset);
-  }
-  else
+  if (_ctx.stream.thread.joinable())
   {
-    if (_ctx.show_prev)
-    {
-      _ctx.line.prev = buf_prev(offset);
-    }
-
-    if (_ctx.show_next)
-    {
-      _ctx.line.next = buf_next(offset);
-    }
+    _ctx.stream.stop = true;
+    _ctx.stream.thread.join();
   }
 
-  auto const width_left = (_ctx.width / 2) - 1 - offset;
-  auto const width_right = (_ctx.width / 2) + 1 + offset;
-
-  std::size_t pad_left {width_left - _ctx.focus_point - _ctx.line.prev.size()};
-  std::size_t pad_right {width_right - _ctx.word.size() + _ctx.focus_point - _ctx.line.next.size()};
-
-  if (_ctx.width % 2 != 0)
+  if (_ctx.stream.fd != -1)
   {
-    ++pad_right;
+    close(_ctx.stream.fd);
+    _ctx.stream.fd = -1;
   }
 
-  _ctx.line.prev = OB::String::repeat(pad_left, aec::space) + _ctx.line.prev;
-  _ctx.line.curr += _ctx.word;
-  _ctx.line.next +=  OB::String::repeat(pad_right, aec::space);
+  _ctx.stream.chunks.clear();
+  _ctx.stream.done = true;
+  _ctx.stream.open = false;
 }
 
-Fltrdr::Line Fltrdr::get_line()
+bool Fltrdr::update()
 {
-  return _ctx.line;
+  bool const stream {stream_update()};
+  bool const search {search_update()};
+
+  return stream || search;
 }
 
-void Fltrdr::prev_sentence()
+bool Fltrdr::stream_update()
 {
-  if (_ctx.index == _ctx.index_min)
+  if (! _ctx.stream.open)
   {
-    return;
+    return false;
   }
 
-  prev_word();
-  if (_ctx.word.find_first_of(".!?") != std::string::npos)
-  {
-    prev_word();
-    if (_ctx.word.find_first_of(".!?") != std::string::npos)
-    {
-      next_word();
-      return;
-    }
-  }
-  while (_ctx.index > _ctx.index_min)
-  {
-    prev_word();
-    if (_ctx.word.find_first_of(".!?") != std::string::npos)
-    {
-      next_word();
-      break;
-    }
-  }
-}
+  std::vector<std::string> chunks;
+  bool done {false};
 
-void Fltrdr::next_sentence()
-{
-  if (_ctx.index == _ctx.index_max)
   {
-    return;
+    std::lock_guard<std::mutex> lock {_ctx.stream.mutex};
+    chunks.swap(_ctx.stream.chunks);
+    done = _ctx.stream.done;
   }
 
-  while (_ctx.index < _ctx.index_max)
+  if (chunks.empty() && ! done)
   {
-    if (_ctx.word.find_first_of(".!?") != std::string::npos)
-    {
-      next_word();
-      break;
-    }
-    next_word();
+    return false;
   }
-}
 
-void Fltrdr::prev_chapter()
-{
-  if (_ctx.index == _ctx.index_min)
+  for (auto const& e : chunks)
   {
-    return;
+    _ctx.text.append(e);
   }
 
-  while (_ctx.index > _ctx.index_min)
+  if (done)
   {
-    prev_word();
-    if (OB::String::lowercase(_ctx.word).find("chapter") != std::string::npos)
-    {
-      break;
-    }
+    _ctx.text.finish();
+    stream_stop();
   }
-}
 
-void Fltrdr::next_chapter()
-{
-  if (_ctx.index == _ctx.index_max)
+  if (_ctx.text.size() != 0)
   {
-    return;
+    _ctx.index_max = _ctx.text.size();
+    _ctx.pos = _ctx.text.pos(_ctx.index - 1);
   }
 
-  while (_ctx.index < _ctx.index_max)
+  if (done)
   {
-    next_word();
-    if (OB::String::lowercase(_ctx.word).find("chapter") != std::string::npos)
-    {
-      break;
-    }
+    lexicon();
   }
+
+  return true;
 }
 
-std::string Fltrdr::word()
+Decoder::Type Fltrdr::compression(std::string const& path)
 {
-  return _ctx.word;
+  std::ifstream ifile {path, std::ios::binary};
+  std::string head (Decoder::magic_size, '\0');
+  ifile.read(head.data(), static_cast<std::streamsize>(head.size()));
+  head.resize(static_cast<std::size_t>(ifile.gcount()));
+
+  return Decoder::detect(head);
 }
 
-void Fltrdr::current_word()
+std::string Fltrdr::cache_dir()
 {
-  auto const pos = _ctx.text.find(" ", _ctx.pos + 1);
-  if (pos != std::string::npos)
+  // ${XDG_CACHE_HOME}/fltrdr
+  // ${HOME}/.cache/fltrdr
+  std::string cache_home {OB::Term::env_var("XDG_CACHE_HOME")};
+  if (cache_home.empty())
   {
-    _ctx.word = _ctx.text.substr(_ctx.pos + 1, pos - _ctx.pos - 1);
+    cache_home = OB::Term::env_var("HOME") + "/.cache/fltrdr";
   }
   else
   {
-    _ctx.word = _ctx.text.substr(_ctx.pos + 1);
+    cache_home += "/fltrdr";
   }
+
+  return cache_home;
 }
 
-bool Fltrdr::prev_word()
+std::string Fltrdr::cache_file(std::string const& path)
 {
-  if (_ctx.index > _ctx.index_min)
-  {
-    --_ctx.index;
+  // name the cache file after the absolute path of the file,
+  // the full path is also stored in the cache file to detect collisions
+  std::error_code ec;
+  auto const abs = fs::absolute(path, ec).lexically_normal().string();
 
-    auto const pos = _ctx.text.rfind(" ", _ctx.pos - 1);
-    if (pos != std::string::npos)
-    {
-      _ctx.pos = pos;
-      current_word();
+  std::ostringstream name;
+  name << std::hex << std::hash<std::string>{}(abs);
 
-      return true;
-    }
-  }
+  return cache_dir() + "/" + name.str();
+}
 
-  return false;
+void Fltrdr::cache_touch(std::string const& path)
+{
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
 }
 
-bool Fltrdr::next_word()
+void Fltrdr::cache_prune()
 {
-  if (_ctx.index < _ctx.index_max)
+  std::error_code ec;
+  std::vector<std::tuple<fs::file_time_type, std::uintmax_t, fs::path>> files;
+  std::uintmax_t total {0};
+
+  for (auto it = fs::directory_iterator(cache_dir(), ec); ! ec && it != fs::directory_iterator(); it.increment(ec))
   {
-    ++_ctx.index;
+    std::error_code err;
 
-    auto const pos = _ctx.text.find(" ", _ctx.pos + 1);
-    if (pos != std::string::npos && _ctx.text.at(pos))
+    if (! it->is_regular_file(err))
     {
-      _ctx.pos = pos;
-      current_word();
+      continue;
+    }
 
-      return true;
+    auto const size = it->file_size(err);
+    auto const time = it->last_write_time(err);
+
+    if (! err)
+    {
+      files.emplace_back(time, size, it->path());
+      total += size;
     }
   }
 
-  return false;
+  // the files are touched when used, so the oldest go first
+  std::sort(files.begin(), files.end());
+
+  for (auto const& [time, size, path] : files)
+  {
+    if (total <= _ctx.cache_max)
+    {
+      break;
+    }
+
+    if (fs::remove(path, ec))
+    {
+      total -= size;
+    }
+  }
 }
 
-void Fltrdr::set_index(std::size_t i)
+bool Fltrdr::index()
 {
-  if (i <= _ctx.index_min)
+  _ctx.text.index();
+
+  bool const res {_ctx.text.size() != 0};
+
+  if (! res)
   {
-    i = _ctx.index_min;
+    _ctx.text.assign("fltrdr");
+    _ctx.text.index();
   }
-  else if (i >= _ctx.index_max)
+
+  // find the sentence ends up front so that jumps are binary searches
+  _ctx.text.sentences();
+
+  _ctx.index_max = _ctx.text.size();
+  _ctx.pos = _ctx.text.pos(_ctx.index - 1);
+
+  lexicon();
+
+  return res;
+}
+
+void Fltrdr::lexicon()
+{
+  if (! _ctx.lexicon_enabled || _ctx.lexicon.built() || _ctx.stream.open)
   {
-    i = _ctx.index_max;
+    return;
   }
 
-  if (i < _ctx.index)
+  // the index is cached next to the word index of a mapped file
+  auto const key = _ctx.cache.empty() ? 0 : _ctx.text.id();
+  auto const path = _ctx.cache + ".words";
+
+  if (key && _ctx.lexicon.load(path, key))
   {
-    while (i != _ctx.index)
-    {
-      prev_word();
-    }
+    cache_touch(path);
+    return;
   }
-  else if (i > _ctx.index)
+
+  _ctx.lexicon.build(_ctx.text);
+  _ctx.text.touch(0, _ctx.text.indexed());
+
+  if (key)
   {
-    while (i != _ctx.index)
-    {
-      next_word();
-    }
+    _ctx.lexicon.save(path, key);
+    cache_prune();
   }
 }
 
-std::size_t Fltrdr::get_index()
+bool Fltrdr::eof()
 {
-  return _ctx.index;
+  // more words may still arrive while the stream is open
+  return _ctx.index >= _ctx.index_max && ! _ctx.stream.open;
+}
+
+void Fltrdr::begin()
+{
+  set_index(_ctx.index_min);
+}
+
+void Fltrdr::end()
+{
+  set_index(_ctx.index_max);
+}
+
+Fltrdr& Fltrdr::screen_size(std::size_t const width, std::size_t const height)
+{
+  _ctx.width = width;
+  _ctx.height = height;
+
+  return *this;
+}
+
+void Fltrdr::buf_prev(std::string& buf, std::size_t offset)
+{
+  buf.clear();
+
+  if (_ctx.index == _ctx.index_min)
+  {
+    return;
+  }
+
+  auto const width = (_ctx.width / 2) - 1 - offset;
+
+  int const size {static_cast<int>(width - _ctx.focus_point)};
+  if (size < 1)
+  {
+    return;
+  }
+
+  auto const max = static_cast<std::size_t>(size);
+
+  // number of words to show before the current word
+  auto count = _ctx.show_line ? _ctx.index - _ctx.index_min :
+    std::min(static_cast<std::size_t>(_ctx.show_prev), _ctx.index - _ctx.index_min);
+
+  // count the words from right to left, each word with a leading space,
+  // until they fill the buffer
+  std::size_t total {1};
+  for (std::size_t i = 1; i <= count; ++i)
+  {
+    if (total >= max)
+    {
+      count = i - 1;
+      break;
+    }
+
+    total += 1 + _ctx.text.word(_ctx.index - 1 - i).size();
+  }
+
+  // then add them from left to right, cutting off the start of the first
+  for (auto i = count; i >= 1; --i)
+  {
+    buf += ' ';
+    buf += _ctx.text.word(_ctx.index - 1 - i);
+  }
+
+  buf += ' ';
+
+  if (buf.size() > max)
+  {
+    buf.erase(0, buf.size() - max);
+  }
+}
+
+void Fltrdr::buf_next(std::string& buf, std::size_t offset)
+{
+  buf.clear();
+
+  if (_ctx.index == _ctx.index_max)
+  {
+    return;
+  }
+
+  auto const width = (_ctx.width / 2) + 1 + offset;
+
+  int size {static_cast<int>(width - (_ctx.word.size() - _ctx.focus_point))};
+
+  if (_ctx.width % 2 != 0)
+  {
+    ++size;
+  }
+
+  if (size < 1)
+  {
+    return;
+  }
+
+  auto const max = static_cast<std::size_t>(size);
+
+  // number of words to show after the current word
+  auto const count = _ctx.show_line ? _ctx.index_max - _ctx.index :
+    std::min(static_cast<std::size_t>(_ctx.show_next), _ctx.index_max - _ctx.index);
+
+  // build the words up from left to right, each word with a leading space,
+  // until the buffer is full
+  for (std::size_t i = 1; i <= count && buf.size() < max; ++i)
+  {
+    buf += ' ';
+    buf += _ctx.text.word(_ctx.index - 1 + i);
+  }
+
+  // trailing space when more words follow
+  if (_ctx.index + count < _ctx.index_max)
+  {
+    buf += ' ';
+  }
+
+  if (buf.size() > max)
+  {
+    buf.resize(max);
+  }
+}
+
+void Fltrdr::set_focus_point()
+{
+  std::size_t begin {0};
+  std::size_t end {_ctx.word.size()};
+
+  // check for punct at beginning of word
+  for (auto i = _ctx.word.begin(); i != _ctx.word.end(); ++i)
+  {
+    if (std::isalpha(static_cast<unsigned char>(*i)) != 0)
+    {
+      break;
+    }
+
+    ++begin;
+  }
+
+  // check for punct at end of word
+  for (auto i = _ctx.word.rbegin(); i != _ctx.word.rend(); ++i)
+  {
+    if (std::isalpha(static_cast<unsigned char>(*i)) != 0)
+    {
+      if (*i == 's' && ++i != _ctx.word.rend() && *i == '\'')
+      {
+        end -= 2;
+      }
+
+      break;
+    }
+
+    --end;
+  }
+
+  auto size {end - begin};
+  if (size > _ctx.word.size() || size == 0)
+  {
+    size = _ctx.word.size();
+  }
+
+  if (size < 13)
+  {
+    _ctx.focus_point = std::round(size * _ctx.focus);
+  }
+  else
+  {
+    _ctx.focus_point = 3;
+  }
+
+  if (_ctx.word.size() != size)
+  {
+    _ctx.focus_point += begin;
+  }
+}
+
+void Fltrdr::set_line(std::size_t offset)
+{
+  // keep the text around the current word in memory
+  _ctx.text.window(_ctx.pos);
+
+  // reuse the line while nothing it is laid out from has changed
+  Ctx::Layout const layout {true, _ctx.index, _ctx.index_max, _ctx.width, offset,
+    _ctx.show_line, _ctx.show_prev, _ctx.show_next};
+
+  if (layout == _ctx.layout)
+  {
+    return;
+  }
+
+  _ctx.layout = layout;
+
+  // lay out the line in place, reusing the memory of the previous one
+  auto& line = _ctx.line;
+  line.prev.clear();
+  line.curr.clear();
+  line.next.clear();
+
+  current_word();
+  set_focus_point();
+
+  if (_ctx.show_line)
+  {
+    buf_prev(line.prev, offset);
+    buf_next(line.next, offset);
+  }
+  else
+  {
+    if (_ctx.show_prev)
+    {
+      buf_prev(line.prev, offset);
+    }
+
+    if (_ctx.show_next)
+    {
+      buf_next(line.next, offset);
+    }
+  }
+
+  auto const width_left = (_ctx.width / 2) - 1 - offset;
+  auto const width_right = (_ctx.width / 2) + 1 + offset;
+
+  std::size_t pad_left {width_left - _ctx.focus_point - line.prev.size()};
+  std::size_t pad_right {width_right - _ctx.word.size() + _ctx.focus_point - line.next.size()};
+
+  if (_ctx.width % 2 != 0)
+  {
+    ++pad_right;
+  }
+
+  line.prev.insert(0, pad_left, ' ');
+  line.curr += _ctx.word;
+  line.next.append(pad_right, ' ');
+}
+
+Fltrdr::Line const& Fltrdr::get_line() const
+{
+  return _ctx.line;
+}
+
+void Fltrdr::prev_sentence()
+{
+  if (_ctx.index == _ctx.index_min)
+  {
+    return;
+  }
+
+  auto const& bounds = _ctx.text.sentences();
+
+  auto const ends = [&](std::size_t const i) {
+    return std::binary_search(bounds.begin(), bounds.end(), i - 1);
+  };
+
+  // when the prev word ends a sentence, step over it,
+  // stopping after the word before it if that also ends a sentence
+  auto index = _ctx.index - 1;
+  if (ends(index))
+  {
+    auto const prev = std::max(index - 1, _ctx.index_min);
+    if (ends(prev))
+    {
+      set_index(prev + 1);
+      return;
+    }
+
+    index = prev;
+  }
+
+  // goto the word after the last sentence end before index
+  if (auto const it = std::lower_bound(bounds.begin(), bounds.end(), index - 1);
+    it != bounds.begin())
+  {
+    set_index(*std::prev(it) + 2);
+  }
+  else
+  {
+    set_index(_ctx.index_min);
+  }
+}
+
+void Fltrdr::next_sentence()
+{
+  if (_ctx.index == _ctx.index_max)
+  {
+    return;
+  }
+
+  auto const& bounds = _ctx.text.sentences();
+
+  // goto the word after the first sentence end at or after the current word
+  if (auto const it = std::lower_bound(bounds.begin(), bounds.end(), _ctx.index - 1);
+    it != bounds.end())
+  {
+    set_index(*it + 2);
+  }
+  else
+  {
+    set_index(_ctx.index_max);
+  }
+}
+
+void Fltrdr::prev_chapter()
+{
+  if (_ctx.index == _ctx.index_min)
+  {
+    return;
+  }
+
+  auto const& bounds = _ctx.text.chapters();
+
+  // goto the last chapter start before the current word
+  if (auto const it = std::lower_bound(bounds.begin(), bounds.end(), _ctx.index - 1);
+    it != bounds.begin())
+  {
+    set_index(*std::prev(it) + 1);
+  }
+  else
+  {
+    set_index(_ctx.index_min);
+  }
+}
+
+void Fltrdr::next_chapter()
+{
+  if (_ctx.index == _ctx.index_max)
+  {
+    return;
+  }
+
+  auto const& bounds = _ctx.text.chapters();
+
+  // goto the first chapter start after the current word
+  if (auto const it = std::upper_bound(bounds.begin(), bounds.end(), _ctx.index - 1);
+    it != bounds.end())
+  {
+    set_index(*it + 1);
+  }
+  else
+  {
+    set_index(_ctx.index_max);
+  }
+}
+
+void Fltrdr::set_budget(std::size_t const size)
+{
+  // text not backed by a file is spilled to disk next to the cache files,
+  // as the temporary directory is often kept in memory
+  _ctx.text.set_spill(cache_dir());
+  _ctx.text.set_budget(size);
+}
+
+std::size_t Fltrdr::get_budget()
+{
+  return _ctx.text.budget();
+}
+
+bool Fltrdr::set_chapter(std::string const& rx)
+{
+  try
+  {
+    _ctx.text.set_chapter(rx);
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+std::string Fltrdr::word()
+{
+  return _ctx.word;
+}
+
+void Fltrdr::current_word()
+{
+  _ctx.word = _ctx.text.word(_ctx.index - 1);
+}
+
+bool Fltrdr::prev_word()
+{
+  if (_ctx.index > _ctx.index_min)
+  {
+    --_ctx.index;
+    _ctx.pos = _ctx.text.pos(_ctx.index - 1);
+    current_word();
+
+    return true;
+  }
+
+  return false;
+}
+
+bool Fltrdr::next_word()
+{
+  if (_ctx.index < _ctx.index_max)
+  {
+    ++_ctx.index;
+    _ctx.pos = _ctx.text.pos(_ctx.index - 1);
+    current_word();
+
+    return true;
+  }
+
+  return false;
+}
+
+void Fltrdr::set_index(std::size_t i)
+{
+  if (i <= _ctx.index_min)
+  {
+    i = _ctx.index_min;
+  }
+  else if (i >= _ctx.index_max)
+  {
+    i = _ctx.index_max;
+  }
+
+  // jump directly to the word through the word index
+  _ctx.index = i;
+  _ctx.pos = _ctx.text.pos(_ctx.index - 1);
+  current_word();
+}
+
+std::size_t Fltrdr::get_index()
+{
+  return _ctx.index;
 }
 
 int Fltrdr::get_wait()
@@ -539,263 +1030,872 @@ void Fltrdr::set_wpm(int const i)
   }
 }
 
-void Fltrdr::inc_wpm()
+void Fltrdr::inc_wpm()
+{
+  _ctx.wpm += _ctx.wpm_diff;
+
+  if (_ctx.wpm > _ctx.wpm_max)
+  {
+    _ctx.wpm = _ctx.wpm_max;
+  }
+}
+
+void Fltrdr::dec_wpm()
+{
+  _ctx.wpm -= _ctx.wpm_diff;
+
+  if (_ctx.wpm < _ctx.wpm_min)
+  {
+    _ctx.wpm = _ctx.wpm_min;
+  }
+}
+
+std::string Fltrdr::get_stats()
+{
+  std::ostringstream buf;
+
+  // number of the match in or before the current word, and the number of matches,
+  // marked with a '+' while more are being searched for
+  if (_ctx.search.active)
+  {
+    auto const& words = _ctx.search.words;
+
+    buf
+    << std::upper_bound(words.begin(), words.end(), _ctx.index) - words.begin()
+    << "/" << words.size() << (_ctx.search.running ? "+ " : " ");
+  }
+
+  buf
+  << timer.str() << " "
+  << _ctx.wpm_avg << "avg "
+  << _ctx.wpm << "wpm "
+  << _ctx.index << "w "
+  << static_cast<int>(_ctx.index / static_cast<double>(_ctx.index_max) * 100) << "%";
+
+  return buf.str();
+}
+
+void Fltrdr::set_show_line(bool const val)
+{
+  _ctx.show_line = val;
+}
+
+bool Fltrdr::get_show_line()
+{
+  return _ctx.show_line;
+}
+
+void Fltrdr::set_show_prev(int const val)
+{
+  if (val >= _ctx.show_min && val <= _ctx.show_max)
+  {
+    _ctx.show_prev = val;
+  }
+}
+
+int Fltrdr::get_show_prev()
+{
+  return _ctx.show_prev;
+}
+
+void Fltrdr::set_show_next(int const val)
+{
+  if (val >= _ctx.show_min && val <= _ctx.show_max)
+  {
+    _ctx.show_next = val;
+  }
+}
+
+int Fltrdr::get_show_next()
+{
+  return _ctx.show_next;
+}
+
+std::size_t Fltrdr::progress()
+{
+  return static_cast<std::size_t>(_ctx.index / static_cast<double>(_ctx.index_max) * 100);
+}
+
+bool Fltrdr::search_next()
+{
+  _ctx.search.jump = false;
+
+  if (_ctx.search.matches.empty())
+  {
+    return false;
+  }
+
+  if (_ctx.search.forward)
+  {
+    next_match();
+  }
+  else
+  {
+    prev_match();
+  }
+
+  return true;
+}
+
+bool Fltrdr::search_prev()
+{
+  _ctx.search.jump = false;
+
+  if (_ctx.search.matches.empty())
+  {
+    return false;
+  }
+
+  if (_ctx.search.forward)
+  {
+    prev_match();
+  }
+  else
+  {
+    next_match();
+  }
+
+  return true;
+}
+
+void Fltrdr::next_match()
+{
+  if (_ctx.index >= _ctx.index_max)
+  {
+    return;
+  }
+
+  // first match from the start of the next word
+  auto const& matches = _ctx.search.matches;
+  auto const it = std::lower_bound(matches.begin(), matches.end(), _ctx.text.pos(_ctx.index));
+
+  if (it == matches.end())
+  {
+    return;
+  }
+
+  set_index(_ctx.search.words.at(static_cast<std::size_t>(it - matches.begin())));
+}
+
+void Fltrdr::prev_match()
+{
+  if (! _ctx.text.size())
+  {
+    return;
+  }
+
+  // last match before the start of the current word
+  auto const& matches = _ctx.search.matches;
+  auto const it = std::lower_bound(matches.begin(), matches.end(), _ctx.pos);
+
+  if (it == matches.begin())
+  {
+    return;
+  }
+
+  auto const i = static_cast<std::size_t>(it - matches.begin()) - 1;
+  auto index = _ctx.search.words.at(i);
+
+  // a match ending right before a word lands on that word
+  if (index < _ctx.text.size() && _ctx.text.pos(index) == matches.at(i) + 1)
+  {
+    ++index;
+  }
+
+  set_index(index);
+}
+
+bool Fltrdr::search_forward(std::string const& rx)
+{
+  return search([&](Pattern& pattern) { return pattern.compile(rx); }, true);
+}
+
+bool Fltrdr::search_backward(std::string const& rx)
+{
+  return search([&](Pattern& pattern) { return pattern.compile(rx); }, false);
+}
+
+bool Fltrdr::search_set(std::vector<std::string> const& strs)
+{
+  return search([&](Pattern& pattern) { return pattern.compile(strs); }, true);
+}
+
+bool Fltrdr::search_fuzzy(std::string const& str, std::size_t const dist)
+{
+  return search([&](Pattern& pattern) { return pattern.compile(str, dist); }, true);
+}
+
+bool Fltrdr::search_word(std::string const& word, bool const forward)
+{
+  auto const key = Lexicon::normalize(word);
+
+  if (key.empty())
+  {
+    auto const rx = Pattern::escape(word);
+
+    return forward ? search_forward(rx) : search_backward(rx);
+  }
+
+  // without the index, search for the words equal to the key,
+  // split at the max width like the words the index is built from
+  if (! _ctx.lexicon.built())
+  {
+    return search([&](Pattern& pattern) { return pattern.compile(key, 0, _ctx.text.width()); }, forward);
+  }
+
+  search_stop();
+
+  // the matches all come from the index,
+  // there is no pattern for the text to be searched with
+  _ctx.search.pattern.clear();
+  matches_clear();
+
+  for (auto const i : _ctx.lexicon.find(key))
+  {
+    // an index loaded from a cache file may not match the text
+    if (i >= _ctx.text.size())
+    {
+      break;
+    }
+
+    _ctx.search.matches.emplace_back(_ctx.text.pos(i));
+    _ctx.search.words.emplace_back(i + 1);
+  }
+
+  _ctx.search.pos = _ctx.text.indexed();
+  _ctx.search.forward = forward;
+  _ctx.search.active = true;
+  search_next();
+
+  return true;
+}
+
+void Fltrdr::set_word_index(bool const val)
 {
-  _ctx.wpm += _ctx.wpm_diff;
+  _ctx.lexicon_enabled = val;
 
-  if (_ctx.wpm > _ctx.wpm_max)
+  if (val)
   {
-    _ctx.wpm = _ctx.wpm_max;
+    lexicon();
+  }
+  else
+  {
+    _ctx.lexicon.clear();
   }
 }
 
-void Fltrdr::dec_wpm()
+bool Fltrdr::get_word_index()
 {
-  _ctx.wpm -= _ctx.wpm_diff;
+  return _ctx.lexicon_enabled;
+}
 
-  if (_ctx.wpm < _ctx.wpm_min)
+std::optional<std::size_t> Fltrdr::word_count(std::string const& word)
+{
+  if (! _ctx.lexicon.built())
   {
-    _ctx.wpm = _ctx.wpm_min;
+    return {};
   }
+
+  return _ctx.lexicon.count(Lexicon::normalize(word));
 }
 
-std::string Fltrdr::get_stats()
+std::string Fltrdr::word_index_stats()
 {
   std::ostringstream buf;
 
   buf
-  << timer.str() << " "
-  << _ctx.wpm_avg << "avg "
-  << _ctx.wpm << "wpm "
-  << _ctx.index << "w "
-  << static_cast<int>(_ctx.index / static_cast<double>(_ctx.index_max) * 100) << "%";
+  << _ctx.lexicon.total() << " words, "
+  << _ctx.lexicon.size() << " distinct, "
+  << (_ctx.lexicon.memory() + 1023) / 1024 << " KiB";
 
   return buf.str();
 }
 
-void Fltrdr::set_show_line(bool const val)
+bool Fltrdr::search_match()
 {
-  _ctx.show_line = val;
+  auto const& words = _ctx.search.words;
+
+  return _ctx.search.active && std::binary_search(words.begin(), words.end(), _ctx.index);
 }
 
-bool Fltrdr::get_show_line()
+bool Fltrdr::searching() const
 {
-  return _ctx.show_line;
+  return _ctx.search.running;
 }
 
-void Fltrdr::set_show_prev(int const val)
+void Fltrdr::search_clear()
 {
-  if (val >= _ctx.show_min && val <= _ctx.show_max)
-  {
-    _ctx.show_prev = val;
-  }
+  search_stop();
+
+  _ctx.search.pattern.clear();
+  matches_clear();
+  _ctx.search.active = false;
+  _ctx.search.jump = false;
 }
 
-int Fltrdr::get_show_prev()
+bool Fltrdr::search(std::function<bool(Pattern&)> const& compile, bool const forward)
 {
-  return _ctx.show_prev;
+  // plain text of the previous search when it has searched all of the text
+  std::string prev;
+
+  if (_ctx.search.active && ! _ctx.search.running && _ctx.search.pos == _ctx.text.indexed())
+  {
+    prev = _ctx.search.pattern.literal();
+  }
+
+  // a new search replaces the one in progress
+  search_stop();
+
+  _ctx.search.forward = forward;
+  _ctx.search.active = false;
+  _ctx.search.jump = false;
+
+  if (! compile(_ctx.search.pattern))
+  {
+    matches_clear();
+
+    return false;
+  }
+
+  _ctx.search.pattern.set_stop(&_ctx.search.stop);
+  _ctx.search.active = true;
+
+  // extending the previous text narrows down its matches
+  if (! prev.empty() && search_refine(prev))
+  {
+    search_next();
+
+    return true;
+  }
+
+  matches_clear();
+  _ctx.search.jump = true;
+  search_start(0);
+
+  return true;
 }
 
-void Fltrdr::set_show_next(int const val)
+bool Fltrdr::search_refine(std::string const& prev)
 {
-  if (val >= _ctx.show_min && val <= _ctx.show_max)
+  auto const& str = _ctx.search.pattern.literal();
+
+  if (str.compare(0, prev.size(), prev) != 0)
   {
-    _ctx.show_next = val;
+    return false;
+  }
+
+  // the matches of text that can overlap itself
+  // leave out the occurrences overlapping them
+  for (std::size_t i = 1; i < prev.size(); ++i)
+  {
+    if (prev.compare(0, i, prev, prev.size() - i, i) == 0)
+    {
+      return false;
+    }
+  }
+
+  // every match of str starts with an occurrence of prev
+  auto& matches = _ctx.search.matches;
+  auto& words = _ctx.search.words;
+  auto const& segs = _ctx.text.segments();
+  std::size_t seg {0};
+  std::size_t end {0};
+  std::size_t size {0};
+  Pattern::Match match;
+
+  for (std::size_t i = 0; i < matches.size(); ++i)
+  {
+    auto const pos = matches[i];
+
+    if (pos < end)
+    {
+      continue;
+    }
+
+    while (segs.at(seg).pos + segs.at(seg).str.size() <= pos)
+    {
+      ++seg;
+    }
+
+    // look for a match right at the occurrence,
+    // one across the join of two segments is left to a new search
+    auto const begin = pos - segs.at(seg).pos;
+    auto const view = segs.at(seg).str.substr(0, begin + str.size());
+
+    if (view.size() < begin + str.size())
+    {
+      return false;
+    }
+
+    if (! _ctx.search.pattern.find(view, begin, match) || match.begin != begin)
+    {
+      continue;
+    }
+
+    matches[size] = pos;
+    words[size] = words[i];
+    ++size;
+    end = pos + str.size();
   }
+
+  matches.resize(size);
+  words.resize(size);
+  ++_ctx.search.revision;
+
+  return true;
 }
 
-int Fltrdr::get_show_next()
+std::size_t Fltrdr::search_end() const
 {
-  return _ctx.show_next;
+  auto const end = _ctx.text.indexed();
+
+  return _ctx.stream.open ? end - std::min(end, _ctx.search.overlap) : end;
 }
 
-std::size_t Fltrdr::progress()
+void Fltrdr::search_start(std::size_t const pos)
 {
-  return static_cast<std::size_t>(_ctx.index / static_cast<double>(_ctx.index_max) * 100);
+  auto const end = _ctx.text.indexed();
+
+  // the searcher works on its own copy of the segments,
+  // as the text may gain segments while it runs
+  std::vector<Text::Segment> segs;
+
+  for (auto const& seg : _ctx.text.segments())
+  {
+    if (seg.pos + seg.str.size() <= pos || seg.pos >= end)
+    {
+      continue;
+    }
+
+    segs.emplace_back(Text::Segment {seg.pos, seg.str.substr(0, std::min(seg.str.size(), end - seg.pos))});
+  }
+
+  _ctx.text.touch(pos, end);
+  _ctx.search.pos = search_end();
+  _ctx.search.resume = _ctx.search.pos;
+
+  _ctx.search.stop = false;
+  _ctx.search.done = false;
+  _ctx.search.failed = false;
+  _ctx.search.running = true;
+  _ctx.search.thread = std::thread(&Fltrdr::search_text, this, std::move(segs), pos, _ctx.search.pos);
 }
 
-bool Fltrdr::search_next()
+void Fltrdr::search_text(std::vector<Text::Segment> const segs, std::size_t const pos, std::size_t const end)
 {
-  auto const end = std::sregex_iterator();
+  std::vector<std::size_t> found;
+  std::size_t batch {1};
+  bool failed {false};
 
-  if (_ctx.search.it == end)
+  auto const push = [&]()
   {
-    return false;
-  }
+    std::lock_guard<std::mutex> lock {_ctx.search.mutex};
+    _ctx.search.found.insert(_ctx.search.found.end(), found.begin(), found.end());
+    found.clear();
+  };
 
-  if (_ctx.search.forward)
+  auto const add = [&](std::size_t const at)
   {
-    bool last {false};
-    auto const index = get_index();
-    next_word();
+    found.emplace_back(at);
 
-    for (auto ptr = _ctx.search.it; ptr != end; ++ptr)
+    if (found.size() >= batch)
     {
-      if (static_cast<std::size_t>(ptr->position()) > _ctx.pos)
-      {
-        auto pos = static_cast<std::size_t>(ptr->position());
-
-        while (_ctx.pos < pos)
-        {
-          if (! next_word())
-          {
-            last = true;
-            break;
-          }
-        }
+      push();
+      batch = std::min(batch * 2, _ctx.search.batch_max);
+    }
+  };
+
+  // std::regex can not tell where no match can start any more,
+  // so a chunk searched by it would be searched to the end of its segment
+  auto const chunked = std::thread::hardware_concurrency() > 1 &&
+    _ctx.search.pattern.engine() != "regex";
+
+  // search str for the matches starting from offset begin before offset last,
+  // adding them at offset, returns the offset the search resumes at,
+  // the end of the last match or last, whichever is past the other
+  auto const run = [&](std::string_view const str, std::size_t const begin, std::size_t const last,
+    std::size_t const offset)
+  {
+    auto res = std::max(begin, last);
 
-        break;
-      }
+    if (chunked && last > begin && last - begin >= _ctx.search.chunk_size * 2)
+    {
+      return std::max(res, search_chunks(str, begin, last, [&](std::size_t const at) { add(offset + at); }));
     }
 
-    auto const index_new = get_index();
-    if (index != _ctx.index_max)
+    Pattern::Match match;
+
+    // matches never overlap, and are never empty
+    for (auto i = begin; _ctx.search.pattern.find(str, i, last, match); i = match.end)
     {
-      if (! last || (index_new != index && index_new != _ctx.index_max))
+      add(offset + match.begin);
+      res = std::max(res, match.end);
+
+      if (_ctx.search.stop)
       {
-        prev_word();
+        break;
       }
     }
-  }
-  else
+
+    return res;
+  };
+
+  // text position the search resumes at
+  auto resume = pos;
+
+  // both sides of the join of two segments
+  std::string window;
+
+  try
   {
-    for (auto ptr = _ctx.search.it, prev = _ctx.search.it; prev != end; ++ptr)
+    for (std::size_t k = 0; k < segs.size() && ! _ctx.search.stop; ++k)
     {
-      if (ptr == end || static_cast<std::size_t>(ptr->position()) > _ctx.pos)
+      auto const& seg = segs[k];
+      auto const size = seg.str.size();
+
+      if (seg.pos >= end)
+      {
+        break;
+      }
+
+      if (resume >= seg.pos + size)
       {
-        auto pos = static_cast<std::size_t>(prev->position());
+        continue;
+      }
 
-        while (_ctx.pos > pos)
-        {
-          if (! prev_word())
-          {
-            break;
-          }
-        }
+      // offsets in the segment the matches start from and before
+      auto const begin = std::max(resume, seg.pos) - seg.pos;
+      auto const last = std::min(size, end - seg.pos);
 
-        break;
+      // a match starting within overlap of the join with the next segment,
+      // such as the next chunk of a stream, may run into it,
+      // those are searched for in a window holding both sides of the join
+      auto const joined = k + 1 < segs.size() && segs[k + 1].pos == seg.pos + size;
+      auto const part = joined ? std::min(last, size - std::min(size, _ctx.search.overlap)) : last;
+
+      resume = seg.pos + run(seg.str, begin, part, seg.pos);
+
+      if (! joined || resume >= seg.pos + last || _ctx.search.stop)
+      {
+        continue;
       }
 
-      prev = ptr;
+      // the window starts a char early for anchors and word boundaries to look at,
+      // or at the start of the word the search resumes in, for the parts
+      // a long word is split into at the max width to line up with those of the text
+      auto const from = resume - seg.pos;
+      auto const space = from ? seg.str.find_last_of(" \t\n\v\f\r", from - 1) : std::string_view::npos;
+      auto const context = std::min(from, std::max(std::size_t {1}, space == std::string_view::npos ? from : from - space - 1));
+      auto const& next = segs[k + 1];
+
+      window.assign(seg.str.substr(from - context));
+      window.append(next.str.substr(0, std::min(next.str.size(), _ctx.search.overlap)));
+
+      auto const offset = seg.pos + from - context;
+      resume = offset + run(window, context, seg.pos + last - offset, offset);
     }
   }
+  catch (...)
+  {
+    failed = true;
+  }
 
-  return true;
-}
-
-bool Fltrdr::search_prev()
-{
-  auto const end = std::sregex_iterator();
+  push();
 
-  if (_ctx.search.it == end)
   {
-    return false;
+    std::lock_guard<std::mutex> lock {_ctx.search.mutex};
+    _ctx.search.resume = std::max(resume, end);
+    _ctx.search.done = true;
+    _ctx.search.failed = failed;
   }
+}
 
-  if (_ctx.search.forward)
+std::size_t Fltrdr::search_chunks(std::string_view const str, std::size_t const pos, std::size_t const end,
+  std::function<void(std::size_t)> const& add)
+{
+  auto& search = _ctx.search;
+  auto const size = search.chunk_size;
+  auto const count = (end - pos + size - 1) / size;
+  auto const threads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)), count);
+
+  // chunks are searched at most this far ahead of the ones merged
+  auto const ahead = threads * 2;
+
+  // offset of the start of chunk n
+  auto const start = [&](std::size_t const n) {
+    return std::min(end, pos + n * size);
+  };
+
+  // matches starting in each chunk found by searching on from its start,
+  // whether each chunk has been searched, the number of chunks merged,
+  // whether merging has ended, and if a search failed, guarded by mutex
+  std::vector<std::vector<Pattern::Match>> chunks (count);
+  std::vector<bool> ready (count, false);
+  std::size_t merged {0};
+  bool done {false};
+  bool failed {false};
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::atomic<std::size_t> next {0};
+
+  // each thread searches with its own copy of the pattern
+  std::vector<Pattern> patterns (threads, search.pattern);
+
+  std::vector<std::thread> pool;
+  for (std::size_t t = 0; t < threads; ++t)
   {
-    for (auto ptr = _ctx.search.it, prev = _ctx.search.it; prev != end; ++ptr)
-    {
-      if (ptr == end || static_cast<std::size_t>(ptr->position()) > _ctx.pos)
+    pool.emplace_back([&, t] {
+      for (std::size_t n; (n = next++) < count;)
       {
-        auto pos = static_cast<std::size_t>(prev->position());
+        {
+          std::unique_lock<std::mutex> lock {mutex};
+          cond.wait(lock, [&] { return n < merged + ahead || done; });
+
+          if (done)
+          {
+            return;
+          }
+        }
 
-        while (_ctx.pos > pos)
+        std::vector<Pattern::Match> res;
+        bool ok {true};
+
+        try
         {
-          if (! prev_word())
+          Pattern::Match match;
+
+          for (auto i = start(n); patterns[t].find(str, i, start(n + 1), match); i = match.end)
           {
-            break;
+            res.emplace_back(match);
           }
         }
+        catch (...)
+        {
+          ok = false;
+        }
+
+        {
+          std::lock_guard<std::mutex> lock {mutex};
+          chunks[n] = std::move(res);
+          ready[n] = true;
+          failed = failed || ! ok;
+        }
+
+        cond.notify_all();
+      }
+    });
+  }
+
+  // offset the search through the whole of str resumes at
+  auto resume = pos;
+
+  for (std::size_t n = 0; n < count && ! search.stop; ++n)
+  {
+    std::vector<Pattern::Match> res;
+
+    {
+      std::unique_lock<std::mutex> lock {mutex};
+      cond.wait(lock, [&] { return ready[n] || failed || search.stop; });
 
+      if (failed || search.stop)
+      {
         break;
       }
 
-      prev = ptr;
+      res = std::move(chunks[n]);
     }
-  }
-  else
-  {
-    bool last {false};
-    auto const index = get_index();
-    next_word();
 
-    for (auto ptr = _ctx.search.it; ptr != end; ++ptr)
+    auto it = res.begin();
+
+    // the last match ran into the chunk, so the search of the chunk may have
+    // gone through where the search resumes inside a match of its own,
+    // search on from the end of the last match until both searches
+    // resume at the same offset, from where they find the same matches
+    if (resume > start(n))
     {
-      if (static_cast<std::size_t>(ptr->position()) > _ctx.pos)
+      for (Pattern::Match match;;)
       {
-        auto pos = static_cast<std::size_t>(ptr->position());
+        while (it != res.end() && it->end < resume)
+        {
+          ++it;
+        }
 
-        while (_ctx.pos < pos)
+        if (it != res.end() && it->end == resume)
         {
-          if (! next_word())
-          {
-            last = true;
-            break;
-          }
+          ++it;
+          break;
         }
 
-        break;
+        if (! search.pattern.find(str, resume, start(n + 1), match))
+        {
+          it = res.end();
+          break;
+        }
+
+        add(match.begin);
+        resume = match.end;
       }
     }
 
-    auto const index_new = get_index();
-    if (index != _ctx.index_max)
+    for (; it != res.end(); ++it)
     {
-      if (! last || (index_new != index && index_new != _ctx.index_max))
-      {
-        prev_word();
-      }
+      add(it->begin);
+      resume = it->end;
     }
+
+    {
+      std::lock_guard<std::mutex> lock {mutex};
+      merged = n + 1;
+    }
+
+    cond.notify_all();
   }
 
-  return true;
+  {
+    std::lock_guard<std::mutex> lock {mutex};
+    done = true;
+  }
+
+  cond.notify_all();
+
+  for (auto& thread : pool)
+  {
+    thread.join();
+  }
+
+  if (failed)
+  {
+    throw std::runtime_error("search failed");
+  }
+
+  return resume;
 }
 
-bool Fltrdr::search_forward(std::string const& rx)
+bool Fltrdr::search_update()
 {
-  _ctx.search.forward = true;
-  _ctx.search.begin = _ctx.text.begin();
-  _ctx.search.end = _ctx.text.end();
+  auto& search = _ctx.search;
 
-  try
+  if (! search.running)
   {
-    _ctx.search.rgx = std::regex(rx, std::regex::optimize | std::regex::icase);
-    _ctx.search.it = std::sregex_iterator(
-      _ctx.search.begin, _ctx.search.end, _ctx.search.rgx,
-      std::regex_constants::match_not_null);
+    // extend the active search over the text added since
+    if (search.active && search.pos < search_end())
+    {
+      search_start(search.pos);
+    }
+
+    return false;
   }
-  catch (...)
+
+  std::vector<std::size_t> found;
+  bool done {false};
+  bool failed {false};
+
+  {
+    std::lock_guard<std::mutex> lock {search.mutex};
+    found.swap(search.found);
+    done = search.done;
+    failed = search.failed;
+  }
+
+  if (found.empty() && ! done)
   {
-    _ctx.search.rgx = {};
-    _ctx.search.it = std::sregex_iterator();
     return false;
   }
 
-  return search_next();
+  for (auto const pos : found)
+  {
+    auto const words = search.words.empty() ? 0 : search.words.back();
+
+    search.matches.emplace_back(pos);
+    search.words.emplace_back(_ctx.text.count(pos, words));
+  }
+
+  if (done)
+  {
+    search.thread.join();
+    search.running = false;
+    search.pos = search.resume;
+
+    if (failed)
+    {
+      search.pattern.clear();
+      matches_clear();
+      search.active = false;
+      search.jump = false;
+
+      return true;
+    }
+  }
+
+  // jump once the matches up to the current word are known,
+  // matches are found in text order
+  if (search.jump)
+  {
+    auto const pos = search.forward && _ctx.index < _ctx.index_max ?
+      _ctx.text.pos(_ctx.index) : _ctx.pos;
+
+    if (done || (! search.matches.empty() && search.matches.back() >= pos))
+    {
+      search_next();
+    }
+  }
+
+  return true;
 }
 
-bool Fltrdr::search_backward(std::string const& rx)
+void Fltrdr::matches_clear()
+{
+  _ctx.search.matches.clear();
+  _ctx.search.words.clear();
+  ++_ctx.search.revision;
+}
+
+std::vector<std::size_t> const& Fltrdr::search_density(std::size_t const size)
 {
-  _ctx.search.forward = false;
-  _ctx.search.begin = _ctx.text.begin();
-  _ctx.search.end = _ctx.text.end();
+  auto& search = _ctx.search;
+  auto& density = search.density;
 
-  try
+  // count the matches again once the parts no longer line up,
+  // otherwise only the matches added since
+  if (density.counts.size() != size || density.words != _ctx.index_max ||
+    density.revision != search.revision || density.counted > search.words.size())
   {
-    _ctx.search.rgx = std::regex(rx, std::regex::optimize | std::regex::icase);
-    _ctx.search.it = std::sregex_iterator(
-      _ctx.search.begin, _ctx.search.end, _ctx.search.rgx,
-      std::regex_constants::match_not_null);
+    density.counts.assign(size, 0);
+    density.words = _ctx.index_max;
+    density.revision = search.revision;
+    density.counted = 0;
   }
-  catch (...)
+
+  if (size == 0 || _ctx.index_max == 0)
   {
-    _ctx.search.rgx = {};
-    _ctx.search.it = std::sregex_iterator();
-    return false;
+    return density.counts;
+  }
+
+  for (; density.counted < search.words.size(); ++density.counted)
+  {
+    auto const word = search.words[density.counted];
+    auto const part = (word ? word - 1 : 0) * size / _ctx.index_max;
+
+    ++density.counts[std::min(part, size - 1)];
+  }
+
+  return density.counts;
+}
+
+void Fltrdr::search_stop()
+{
+  if (_ctx.search.thread.joinable())
+  {
+    _ctx.search.stop = true;
+    _ctx.search.thread.join();
+    _ctx.search.stop = false;
   }
 
-  return search_next();
+  _ctx.search.found.clear();
+  _ctx.search.done = true;
+  _ctx.search.failed = false;
+  _ctx.search.running = false;
 }
 
 void Fltrdr::reset_timer()
@@ -1,17 +1,29 @@
 #ifndef FLTRDR_HH
 #define FLTRDR_HH
 
+#include "fltrdr/text.hh"
+#include "fltrdr/decoder.hh"
+#include "fltrdr/pattern.hh"
+#include "fltrdr/lexicon.hh"
+
 #include "ob/timer.hh"
 #include "ob/term.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
 #include <cstddef>
+#include <cstdint>
 
 #include <string>
 #include <vector>
 #include <sstream>
 #include <iostream>
 #include <regex>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 
 class Fltrdr
 {
@@ -26,9 +38,18 @@ public:
   };
 
   Fltrdr() = default;
+  ~Fltrdr();
 
   void init();
   bool parse(std::istream& input);
+  bool open(std::string const& path);
+
+  // read from a file descriptor in the background, taking ownership of it,
+  // decompressing the data if it is compressed
+  bool stream(int const fd);
+
+  // add the text read in the background, returns true if the text changed
+  bool update();
 
   Fltrdr& screen_size(std::size_t const width, std::size_t const height);
 
@@ -37,13 +58,14 @@ public:
   void begin();
   void end();
 
-  std::string buf_prev(std::size_t offset = 0);
-  std::string buf_next(std::size_t offset = 0);
+  // lay out the words before and after the current word into buf
+  void buf_prev(std::string& buf, std::size_t offset = 0);
+  void buf_next(std::string& buf, std::size_t offset = 0);
 
   void set_focus_point();
 
   void set_line(std::size_t offset = 0);
-  Line get_line();
+  Line const& get_line() const;
 
   int get_wait();
 
@@ -80,11 +102,55 @@ public:
   void prev_chapter();
   void next_chapter();
 
+  // max size in bytes of the text kept in memory, 0 for no limit
+  void set_budget(std::size_t const size);
+  std::size_t get_budget();
+
+  // set the pattern of the words that start a chapter,
+  // returns false if the pattern is invalid
+  bool set_chapter(std::string const& rx);
+
   bool search_next();
   bool search_prev();
   bool search_forward(std::string const& rx);
   bool search_backward(std::string const& rx);
 
+  // search forwards for any of the plain text strings,
+  // returns false if all are empty
+  bool search_set(std::vector<std::string> const& strs);
+
+  // search forwards for the plain text str within dist edits,
+  // returns false if str is empty or too long, or dist is not below its size
+  bool search_fuzzy(std::string const& str, std::size_t const dist);
+
+  // the current word holds a search match
+  bool search_match();
+
+  // search for the words equal to word once normalized,
+  // through the word index when it is built
+  bool search_word(std::string const& word, bool const forward);
+
+  // build an index of the normalized words for whole word searches
+  void set_word_index(bool const val);
+  bool get_word_index();
+
+  // number of words equal to word once normalized, none without a word index
+  std::optional<std::size_t> word_count(std::string const& word);
+
+  // size and memory use of the word index
+  std::string word_index_stats();
+
+  // a search is still running in the background
+  bool searching() const;
+
+  // number of search matches in each of size equal parts of the text by word,
+  // only the matches added since the last call are counted
+  // unless the size, the text, or the matches have changed
+  std::vector<std::size_t> const& search_density(std::size_t const size);
+
+  // stop and forget the current search
+  void search_clear();
+
   void reset_timer();
   void reset_wpm_avg();
 
@@ -92,6 +158,72 @@ public:
 
 private:
 
+  bool index();
+
+  // build or load the index of the normalized words when enabled
+  void lexicon();
+
+  // compression type of a file
+  Decoder::Type compression(std::string const& path);
+
+  // directory of the cache files
+  std::string cache_dir();
+
+  // path of the cache file for the word index of a file
+  std::string cache_file(std::string const& path);
+
+  // mark a cache file as used, so that it is removed last
+  void cache_touch(std::string const& path);
+
+  // remove the least recently used cache files
+  // until the cache directory is within its max size
+  void cache_prune();
+
+  // start a search for the pattern compiled by compile,
+  // returns false if it can not be compiled
+  bool search(std::function<bool(Pattern&)> const& compile, bool const forward);
+
+  // keep the matches of the finished search for the plain text prev
+  // that match the current pattern, which extends prev,
+  // returns false if they may not hold every match of the current pattern
+  bool search_refine(std::string const& prev);
+
+  // text position before which the matches in the indexed text are known,
+  // short of the end of a stream, as a match there may run on into the text to come
+  std::size_t search_end() const;
+
+  // search the indexed text from text position pos in the background
+  void search_start(std::size_t const pos);
+
+  // search segs from text position pos for the matches starting before text position end,
+  // run by the background searcher
+  void search_text(std::vector<Text::Segment> const segs, std::size_t const pos, std::size_t const end);
+
+  // search str from offset pos in chunks spread over all cores
+  // for the matches starting before offset end,
+  // calling add with the offset of each match in order,
+  // returns the end of the last match, or pos if there is none
+  std::size_t search_chunks(std::string_view const str, std::size_t const pos, std::size_t const end,
+    std::function<void(std::size_t)> const& add);
+
+  // add the matches found in the background, and jump to the first one
+  bool search_update();
+
+  void search_stop();
+
+  // forget the matches found
+  void matches_clear();
+
+  // jump to the word of the first match after the current word
+  void next_match();
+
+  // jump to the word of the last match before the current word
+  void prev_match();
+
+  void stream_read();
+  bool stream_update();
+  void stream_stop();
+
   struct Ctx
   {
     // current terminal size
@@ -105,13 +237,44 @@ private:
     double const focus {0.25};
     std::size_t focus_point {0};
 
-    // text buffer
-    std::string text;
+    // text buffer and word index
+    Text text;
+
+    // index of the normalized words, built when enabled
+    Lexicon lexicon;
+    bool lexicon_enabled {false};
+
+    // cache file of the mapped file, empty if there is none
+    std::string cache;
+
+    // max size of the cache directory
+    std::uintmax_t const cache_max {std::uintmax_t {1} << 30};
 
     // current rendered line
     Line line;
 
-    // text position of leading space to current word
+    // state the current line was laid out for,
+    // the line is only laid out again when it changes
+    struct Layout
+    {
+      bool valid {false};
+      std::size_t index {0};
+      std::size_t index_max {0};
+      std::size_t width {0};
+      std::size_t offset {0};
+      bool show_line {false};
+      int show_prev {0};
+      int show_next {0};
+
+      bool operator==(Layout const& other) const
+      {
+        return valid == other.valid && index == other.index && index_max == other.index_max &&
+          width == other.width && offset == other.offset && show_line == other.show_line &&
+          show_prev == other.show_prev && show_next == other.show_next;
+      }
+    } layout;
+
+    // text position of current word
     std::size_t pos {0};
 
     // word index
@@ -150,12 +313,97 @@ private:
 
     struct Search
     {
-      std::string::const_iterator begin;
-      std::string::const_iterator end;
-      std::regex rgx;
-      std::sregex_iterator it;
+      Pattern pattern;
+
+      // text position of each match
+      std::vector<std::size_t> matches;
+
+      // index of the word each match is in,
+      // the number of words starting at or before the match
+      std::vector<std::size_t> words;
+
+      // incremented whenever the matches are replaced rather than added to
+      std::size_t revision {0};
+
+      // match counts of the parts of the text,
+      // with the number of words and revision of the matches they are for,
+      // and the number of matches counted
+      struct Density
+      {
+        std::vector<std::size_t> counts;
+        std::size_t words {0};
+        std::size_t revision {0};
+        std::size_t counted {0};
+      } density;
+
+      // text position up to which the text has been searched,
+      // or is being searched in the background
+      std::size_t pos {0};
+
+      // text position the finished searcher resumes at,
+      // past the end of its last match, guarded by mutex
+      std::size_t resume {0};
+
+      bool active {false};
       bool forward {true};
+
+      // jump to the first match once it is found
+      bool jump {false};
+
+      // background searcher
+      std::thread thread;
+      std::mutex mutex;
+
+      // text positions of the matches found but not yet added, guarded by mutex
+      std::vector<std::size_t> found;
+
+      // searcher has finished, and if it failed, guarded by mutex
+      bool done {true};
+      bool failed {false};
+
+      // signal the searcher to finish
+      std::atomic<bool> stop {false};
+
+      // searcher is still running
+      bool running {false};
+
+      // max number of matches found before they are handed over,
+      // the first ones are handed over sooner
+      std::size_t const batch_max {4096};
+
+      // size of the chunks a segment is split into to be searched on all cores,
+      // smaller segments are searched on one
+      std::size_t const chunk_size {1 << 23};
+
+      // size of the text on each side of the join of two segments searched as one,
+      // a longer match across a join may be cut short
+      std::size_t const overlap {1 << 16};
     } search;
+
+    // background reader
+    struct Stream
+    {
+      std::thread thread;
+      std::mutex mutex;
+      std::condition_variable cv;
+
+      // chunks read but not yet added to the text, guarded by mutex
+      std::vector<std::string> chunks;
+
+      // reader has finished, guarded by mutex
+      bool done {true};
+
+      // signal the reader to finish
+      std::atomic<bool> stop {false};
+
+      // stream is still being read into the text
+      bool open {false};
+
+      int fd {-1};
+
+      // number of words to read before the first frame is rendered
+      std::size_t const words_min {256};
+    } stream;
   } _ctx;
 };
 
@@ -0,0 +1,441 @@
+#include "fltrdr/lexicon.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+Lexicon::~Lexicon()
+{
+  unmap();
+}
+
+void Lexicon::clear()
+{
+  unmap();
+
+  _ctx.entries.clear();
+  _ctx.entries.shrink_to_fit();
+  _ctx.keys.clear();
+  _ctx.keys.shrink_to_fit();
+  _ctx.postings.clear();
+  _ctx.postings.shrink_to_fit();
+
+  _ctx.entry = nullptr;
+  _ctx.size = 0;
+  _ctx.keys_view = {};
+  _ctx.postings_view = {};
+  _ctx.total = 0;
+}
+
+void Lexicon::unmap()
+{
+  if (_ctx.map)
+  {
+    munmap(_ctx.map, _ctx.map_size);
+    _ctx.map = nullptr;
+    _ctx.map_size = 0;
+  }
+}
+
+std::string Lexicon::normalize(std::string_view const word)
+{
+  auto const is_punct = [](char const c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') ||
+      (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+  };
+
+  std::size_t begin {0};
+  auto end = word.size();
+
+  while (begin < end && is_punct(word[begin]))
+  {
+    ++begin;
+  }
+
+  while (end > begin && is_punct(word[end - 1]))
+  {
+    --end;
+  }
+
+  std::string res {word.substr(begin, end - begin)};
+
+  for (auto& c : res)
+  {
+    if (c >= 'A' && c <= 'Z')
+    {
+      c = static_cast<char>(c + 32);
+    }
+  }
+
+  return res;
+}
+
+void Lexicon::build(Text const& text)
+{
+  clear();
+
+  // postings of each normalized word in the order first seen
+  struct Term
+  {
+    std::string postings;
+    std::size_t last {0};
+    std::size_t count {0};
+  };
+
+  std::unordered_map<std::string, std::size_t> ids;
+  std::vector<Term> terms;
+
+  for (std::size_t i = 0, size = text.size(); i < size; ++i)
+  {
+    auto word = normalize(text.word(i));
+
+    if (word.empty())
+    {
+      continue;
+    }
+
+    auto const [it, added] = ids.try_emplace(std::move(word), terms.size());
+
+    if (added)
+    {
+      terms.emplace_back();
+    }
+
+    auto& term = terms[it->second];
+    put(term.postings, i - term.last);
+    term.last = i;
+    ++term.count;
+  }
+
+  // lay out the words in sorted order so that lookups are binary searches
+  std::vector<std::pair<std::string_view, std::size_t>> order;
+  order.reserve(ids.size());
+
+  for (auto const& [key, id] : ids)
+  {
+    order.emplace_back(key, id);
+  }
+
+  std::sort(order.begin(), order.end());
+
+  _ctx.entries.reserve(order.size() + 1);
+
+  for (auto const& [key, id] : order)
+  {
+    auto& term = terms[id];
+
+    _ctx.entries.push_back({_ctx.keys.size(), _ctx.postings.size(), term.count});
+    _ctx.keys += key;
+    _ctx.postings += term.postings;
+    term.postings = {};
+  }
+
+  _ctx.entries.push_back({_ctx.keys.size(), _ctx.postings.size(), 0});
+  _ctx.keys.shrink_to_fit();
+  _ctx.postings.shrink_to_fit();
+
+  _ctx.entry = _ctx.entries.data();
+  _ctx.size = order.size();
+  _ctx.keys_view = _ctx.keys;
+  _ctx.postings_view = _ctx.postings;
+  _ctx.total = text.size();
+}
+
+bool Lexicon::built() const
+{
+  return _ctx.entry != nullptr;
+}
+
+bool Lexicon::load(std::string const& path, std::uint64_t const key)
+{
+  clear();
+
+  int const fd {open(path.c_str(), O_RDONLY)};
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(Header))
+  {
+    close(fd);
+    return false;
+  }
+
+  auto const size = static_cast<std::size_t>(st.st_size);
+  void* ptr {mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  close(fd);
+
+  if (ptr == MAP_FAILED)
+  {
+    return false;
+  }
+
+  auto const data = static_cast<char const*>(ptr);
+
+  Header head;
+  std::copy_n(data, sizeof(head), reinterpret_cast<char*>(&head));
+
+  // the sections must fit in the file, checked one at a time so that no size overflows
+  auto const fits = [&]() {
+    if (head.entries == 0 || head.entries > (size - sizeof(head)) / sizeof(Entry))
+    {
+      return false;
+    }
+
+    auto const keys = sizeof(head) + head.entries * sizeof(Entry);
+
+    if (head.keys > size - keys || (head.keys + 7) / 8 * 8 > size - keys)
+    {
+      return false;
+    }
+
+    auto const postings = keys + (head.keys + 7) / 8 * 8;
+
+    return head.postings == size - postings;
+  };
+
+  // the cache file must belong to the same text
+  if (std::string_view(head.magic, sizeof(head.magic)) != std::string_view(Header().magic, sizeof(head.magic)) ||
+    head.version != Header().version ||
+    head.key != key ||
+    ! fits())
+  {
+    munmap(ptr, size);
+    return false;
+  }
+
+  auto const keys = sizeof(head) + head.entries * sizeof(Entry);
+  auto const postings = keys + (head.keys + 7) / 8 * 8;
+
+  _ctx.map = ptr;
+  _ctx.map_size = size;
+  _ctx.entry = reinterpret_cast<Entry const*>(data + sizeof(head));
+  _ctx.size = head.entries - 1;
+  _ctx.keys_view = std::string_view(data + keys, head.keys);
+  _ctx.postings_view = std::string_view(data + postings, head.postings);
+  _ctx.total = head.total;
+
+  if (! valid())
+  {
+    clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool Lexicon::valid() const
+{
+  auto const* entry = _ctx.entry;
+  auto const size = _ctx.size;
+
+  // the offsets of the entries start at 0 and end at the sizes of the sections
+  if (entry[0].key != 0 || entry[0].postings != 0 ||
+    entry[size].key != _ctx.keys_view.size() ||
+    entry[size].postings != _ctx.postings_view.size() ||
+    entry[size].count != 0)
+  {
+    return false;
+  }
+
+  std::uint64_t total {0};
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    // each word is not empty and has at least one posting of at least one byte
+    if (entry[i + 1].key <= entry[i].key ||
+      entry[i + 1].postings <= entry[i].postings ||
+      entry[i].count == 0 ||
+      entry[i].count > entry[i + 1].postings - entry[i].postings)
+    {
+      return false;
+    }
+
+    // the words are in sorted order for the binary search
+    if (i && _ctx.keys_view.substr(entry[i - 1].key, entry[i].key - entry[i - 1].key) >=
+      _ctx.keys_view.substr(entry[i].key, entry[i + 1].key - entry[i].key))
+    {
+      return false;
+    }
+
+    total += entry[i].count;
+  }
+
+  // no more postings than words indexed
+  return total <= _ctx.total;
+}
+
+void Lexicon::save(std::string const& path, std::uint64_t const key) const
+{
+  if (! built())
+  {
+    return;
+  }
+
+  Header head;
+  head.key = key;
+  head.total = _ctx.total;
+  head.entries = _ctx.size + 1;
+  head.keys = _ctx.keys_view.size();
+  head.postings = _ctx.postings_view.size();
+
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  // write to a temporary file first so that a partial cache file is never read
+  auto const tmp = path + "." + std::to_string(getpid());
+
+  {
+    std::ofstream file {tmp, std::ios::binary | std::ios::trunc};
+
+    std::string const pad ((8 - head.keys % 8) % 8, '\0');
+
+    file.write(reinterpret_cast<char const*>(&head), sizeof(head));
+    file.write(reinterpret_cast<char const*>(_ctx.entry),
+      static_cast<std::streamsize>(head.entries * sizeof(Entry)));
+    file.write(_ctx.keys_view.data(), static_cast<std::streamsize>(_ctx.keys_view.size()));
+    file.write(pad.data(), static_cast<std::streamsize>(pad.size()));
+    file.write(_ctx.postings_view.data(), static_cast<std::streamsize>(_ctx.postings_view.size()));
+
+    if (file.good())
+    {
+      file.close();
+      fs::rename(tmp, path, ec);
+    }
+  }
+
+  fs::remove(tmp, ec);
+}
+
+std::size_t Lexicon::entry(std::string_view const word) const
+{
+  auto const key = [&](std::size_t const i) {
+    return _ctx.keys_view.substr(_ctx.entry[i].key, _ctx.entry[i + 1].key - _ctx.entry[i].key);
+  };
+
+  std::size_t lo {0};
+  auto hi = _ctx.size;
+
+  while (lo < hi)
+  {
+    auto const mid = lo + (hi - lo) / 2;
+
+    if (key(mid) < word)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return lo < _ctx.size && key(lo) == word ? lo : _ctx.size;
+}
+
+std::vector<std::size_t> Lexicon::find(std::string_view const word) const
+{
+  std::vector<std::size_t> res;
+
+  auto const i = entry(word);
+
+  if (i == _ctx.size)
+  {
+    return res;
+  }
+
+  res.reserve(_ctx.entry[i].count);
+
+  // each posting is the distance from the previous one,
+  // 7 bits per byte with the high bit set on all but the last byte
+  auto const* ptr = reinterpret_cast<unsigned char const*>(_ctx.postings_view.data());
+  auto const* end = ptr + _ctx.entry[i + 1].postings;
+  ptr += _ctx.entry[i].postings;
+
+  std::size_t pos {0};
+
+  while (ptr < end)
+  {
+    std::uint64_t val {0};
+    int shift {0};
+
+    for (; ptr < end && *ptr & 0x80 && shift < 64; ++ptr, shift += 7)
+    {
+      val |= std::uint64_t {*ptr & 0x7fu} << shift;
+    }
+
+    // a varint cut short by the end of the postings, or longer than 64 bits
+    if (ptr == end || shift >= 64)
+    {
+      break;
+    }
+
+    val |= std::uint64_t {*ptr++} << shift;
+
+    // postings are increasing indices of the words indexed
+    if (val >= _ctx.total - pos || (! res.empty() && val == 0))
+    {
+      break;
+    }
+
+    pos += val;
+    res.emplace_back(pos);
+  }
+
+  return res;
+}
+
+std::size_t Lexicon::count(std::string_view const word) const
+{
+  auto const i = entry(word);
+
+  return i == _ctx.size ? 0 : _ctx.entry[i].count;
+}
+
+std::size_t Lexicon::size() const
+{
+  return _ctx.size;
+}
+
+std::size_t Lexicon::total() const
+{
+  return _ctx.total;
+}
+
+std::size_t Lexicon::memory() const
+{
+  if (! built())
+  {
+    return 0;
+  }
+
+  return (_ctx.size + 1) * sizeof(Entry) + _ctx.keys_view.size() + _ctx.postings_view.size();
+}
+
+void Lexicon::put(std::string& buf, std::uint64_t val)
+{
+  for (; val >= 0x80; val >>= 7)
+  {
+    buf += static_cast<char>((val & 0x7f) | 0x80);
+  }
+
+  buf += static_cast<char>(val);
+}
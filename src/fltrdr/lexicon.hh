@@ -0,0 +1,115 @@
+#ifndef LEXICON_HH
+#define LEXICON_HH
+
+#include "fltrdr/text.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// inverted index from each normalized word to the indices of the words it occurs as,
+// postings are stored as varint encoded deltas
+class Lexicon
+{
+public:
+
+  Lexicon() = default;
+  Lexicon(Lexicon const&) = delete;
+  Lexicon& operator=(Lexicon const&) = delete;
+  ~Lexicon();
+
+  void clear();
+
+  // word with its ascii letters lowercased
+  // and its leading and trailing ascii punctuation removed
+  static std::string normalize(std::string_view const word);
+
+  // build the index over the words of text
+  void build(Text const& text);
+
+  // index has been built or loaded
+  bool built() const;
+
+  // load the index from a cache file saved with the same key,
+  // returns false if the cache file is missing or out of date
+  bool load(std::string const& path, std::uint64_t const key);
+
+  // save the index to a cache file
+  void save(std::string const& path, std::uint64_t const key) const;
+
+  // sorted indices of the words equal to word once normalized,
+  // word is expected to be normalized
+  std::vector<std::size_t> find(std::string_view const word) const;
+
+  // number of words equal to word once normalized
+  std::size_t count(std::string_view const word) const;
+
+  // number of distinct normalized words
+  std::size_t size() const;
+
+  // number of words indexed
+  std::size_t total() const;
+
+  // size in bytes of the index
+  std::size_t memory() const;
+
+private:
+
+  void unmap();
+
+  // offsets and counts of the entries of a loaded index are in range
+  bool valid() const;
+
+  // number of the entry for word, or size() if there is none
+  std::size_t entry(std::string_view const word) const;
+
+  static void put(std::string& buf, std::uint64_t val);
+
+  // a normalized word, its postings, and its number of postings,
+  // the offsets of the next entry end the offsets of an entry
+  struct Entry
+  {
+    std::uint64_t key {0};
+    std::uint64_t postings {0};
+    std::uint64_t count {0};
+  };
+
+  // cache file header, followed by the entries including the last end entry,
+  // the normalized words padded to 8 chars, and the postings
+  struct Header
+  {
+    char magic[8] {'f', 'l', 't', 'r', 'd', 'r', 'l', 'x'};
+    std::uint64_t version {1};
+    std::uint64_t key {0};
+    std::uint64_t total {0};
+    std::uint64_t entries {0};
+    std::uint64_t keys {0};
+    std::uint64_t postings {0};
+  };
+
+  struct Ctx
+  {
+    // owned index, empty when mapped from a cache file
+    std::vector<Entry> entries;
+    std::string keys;
+    std::string postings;
+
+    // index in use, one entry past the last word
+    Entry const* entry {nullptr};
+    std::size_t size {0};
+    std::string_view keys_view;
+    std::string_view postings_view;
+
+    // number of words indexed
+    std::size_t total {0};
+
+    // memory mapped cache file
+    void* map {nullptr};
+    std::size_t map_size {0};
+  } _ctx;
+};
+
+#endif // LEXICON_HH
@@ -0,0 +1,2735 @@
+#include "fltrdr/pattern.hh"
+#include "fltrdr/text.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <bitset>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <regex>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+namespace
+{
+
+using Set = std::bitset<256>;
+
+enum class Anchor
+{
+  begin,
+  end,
+  word,
+  not_word,
+};
+
+// parsed pattern
+struct Node
+{
+  enum class Type
+  {
+    empty,
+    set,
+    anchor,
+    cat,
+    alt,
+    repeat,
+  };
+
+  Type type {Type::empty};
+
+  // chars matched by a set
+  Set set;
+
+  Anchor anchor {Anchor::begin};
+
+  // children of a cat or alt, the repeated node of a repeat
+  std::vector<Node> nodes;
+
+  // repeat count, max is npos for no limit
+  std::size_t min {0};
+  std::size_t max {0};
+  bool greedy {true};
+};
+
+std::size_t const npos {std::string_view::npos};
+
+// max number of chars searched before looking at the stop flag
+std::size_t const check_size {1 << 20};
+
+unsigned char lower(unsigned char const c)
+{
+  return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + 32) : c;
+}
+
+bool is_word(unsigned char const c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool is_space(unsigned char const c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// ascii punctuation, stripped from the ends of a word like the word index does
+bool is_punct(unsigned char const c)
+{
+  return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+Set range(unsigned char const first, unsigned char const last)
+{
+  Set set;
+
+  for (std::size_t c = first; c <= last; ++c)
+  {
+    set.set(c);
+  }
+
+  return set;
+}
+
+// add the other case of each ascii letter in the set
+Set fold(Set set)
+{
+  for (unsigned char c = 'a'; c <= 'z'; ++c)
+  {
+    if (set[c] || set[c - 32u])
+    {
+      set.set(c);
+      set.set(c - 32u);
+    }
+  }
+
+  return set;
+}
+
+// recursive descent parser for the regular subset of ECMAScript patterns,
+// anything else is rejected and left to std::regex
+class Parser
+{
+public:
+
+  explicit Parser(std::string_view const rx) :
+    _rx {rx}
+  {
+  }
+
+  // returns false if the pattern is invalid or beyond the regular subset
+  bool parse(Node& node)
+  {
+    return alt(node) && _i == _rx.size();
+  }
+
+private:
+
+  bool more() const
+  {
+    return _i < _rx.size();
+  }
+
+  bool alt(Node& node)
+  {
+    if (! cat(node))
+    {
+      return false;
+    }
+
+    if (! more() || _rx[_i] != '|')
+    {
+      return true;
+    }
+
+    Node res;
+    res.type = Node::Type::alt;
+    res.nodes.emplace_back(std::move(node));
+
+    while (more() && _rx[_i] == '|')
+    {
+      ++_i;
+      res.nodes.emplace_back();
+
+      if (! cat(res.nodes.back()))
+      {
+        return false;
+      }
+    }
+
+    node = std::move(res);
+
+    return true;
+  }
+
+  bool cat(Node& node)
+  {
+    node = {};
+    node.type = Node::Type::cat;
+
+    while (more() && _rx[_i] != '|' && _rx[_i] != ')')
+    {
+      node.nodes.emplace_back();
+
+      if (! atom(node.nodes.back()) || ! repeat(node.nodes.back()))
+      {
+        return false;
+      }
+    }
+
+    if (node.nodes.size() == 1)
+    {
+      node = Node(std::move(node.nodes.front()));
+    }
+    else if (node.nodes.empty())
+    {
+      node.type = Node::Type::empty;
+    }
+
+    return true;
+  }
+
+  bool atom(Node& node)
+  {
+    auto const c = static_cast<unsigned char>(_rx[_i++]);
+
+    switch (c)
+    {
+      case '(':
+      {
+        // only non-capturing groups, lookaheads are left to std::regex
+        if (more() && _rx[_i] == '?')
+        {
+          if (_i + 1 >= _rx.size() || _rx[_i + 1] != ':')
+          {
+            return false;
+          }
+
+          _i += 2;
+        }
+
+        if (++_depth > _depth_max || ! alt(node) || ! more() || _rx[_i] != ')')
+        {
+          return false;
+        }
+
+        --_depth;
+        ++_i;
+
+        return true;
+      }
+
+      case '[':
+      {
+        node.type = Node::Type::set;
+
+        return klass(node.set);
+      }
+
+      case '.':
+      {
+        node.type = Node::Type::set;
+        node.set.set();
+        node.set.reset('\n');
+        node.set.reset('\r');
+
+        return true;
+      }
+
+      case '^':
+      {
+        node.type = Node::Type::anchor;
+        node.anchor = Anchor::begin;
+
+        return true;
+      }
+
+      case '$':
+      {
+        node.type = Node::Type::anchor;
+        node.anchor = Anchor::end;
+
+        return true;
+      }
+
+      case '\\':
+      {
+        if (! more())
+        {
+          return false;
+        }
+
+        auto const e = _rx[_i];
+
+        if (e == 'b' || e == 'B')
+        {
+          ++_i;
+          node.type = Node::Type::anchor;
+          node.anchor = e == 'b' ? Anchor::word : Anchor::not_word;
+
+          return true;
+        }
+
+        node.type = Node::Type::set;
+
+        return escape(node.set, false);
+      }
+
+      case '*': case '+': case '?': case '{': case '}': case ']': case ')': case '|':
+      {
+        return false;
+      }
+
+      default:
+      {
+        node.type = Node::Type::set;
+        node.set = fold(Set().set(c));
+
+        return true;
+      }
+    }
+  }
+
+  bool repeat(Node& node)
+  {
+    if (! more())
+    {
+      return true;
+    }
+
+    std::size_t min {0};
+    std::size_t max {npos};
+
+    switch (_rx[_i])
+    {
+      case '*':
+        break;
+
+      case '+':
+        min = 1;
+        break;
+
+      case '?':
+        max = 1;
+        break;
+
+      case '{':
+      {
+        auto const num = [&](std::size_t& val) {
+          auto const begin = _i;
+          val = 0;
+
+          for (; more() && _rx[_i] >= '0' && _rx[_i] <= '9'; ++_i)
+          {
+            val = val * 10 + static_cast<std::size_t>(_rx[_i] - '0');
+
+            if (val > _repeat_max)
+            {
+              return false;
+            }
+          }
+
+          return _i > begin;
+        };
+
+        auto const begin = _i++;
+
+        if (! num(min))
+        {
+          _i = begin;
+
+          return false;
+        }
+
+        max = min;
+
+        if (more() && _rx[_i] == ',')
+        {
+          ++_i;
+          max = npos;
+
+          if (more() && _rx[_i] != '}' && (! num(max) || max < min))
+          {
+            return false;
+          }
+        }
+
+        if (! more() || _rx[_i] != '}')
+        {
+          return false;
+        }
+
+        break;
+      }
+
+      default:
+        return true;
+    }
+
+    ++_i;
+
+    // anchors can not be repeated
+    if (node.type == Node::Type::anchor)
+    {
+      return false;
+    }
+
+    Node res;
+    res.type = Node::Type::repeat;
+    res.min = min;
+    res.max = max;
+
+    if (more() && _rx[_i] == '?')
+    {
+      ++_i;
+      res.greedy = false;
+    }
+
+    // a repeat of a repeat is an error
+    if (more() && (_rx[_i] == '*' || _rx[_i] == '+' || _rx[_i] == '?' || _rx[_i] == '{'))
+    {
+      return false;
+    }
+
+    res.nodes.emplace_back(std::move(node));
+    node = std::move(res);
+
+    return true;
+  }
+
+  // parse the escape after a backslash into set,
+  // within a class \b is a backspace
+  bool escape(Set& set, bool const in_class)
+  {
+    auto const c = _rx[_i++];
+
+    switch (c)
+    {
+      case 'd': set = range('0', '9'); return true;
+      case 'D': set = ~range('0', '9'); return true;
+      case 'w': set = word(); return true;
+      case 'W': set = ~word(); return true;
+      case 's': set = space(); return true;
+      case 'S': set = ~space(); return true;
+      case 'n': set.set('\n'); return true;
+      case 't': set.set('\t'); return true;
+      case 'r': set.set('\r'); return true;
+      case 'f': set.set('\f'); return true;
+      case 'v': set.set('\v'); return true;
+
+      case 'b':
+      {
+        if (! in_class)
+        {
+          return false;
+        }
+
+        set.set('\b');
+
+        return true;
+      }
+
+      case '0':
+      {
+        if (more() && _rx[_i] >= '0' && _rx[_i] <= '9')
+        {
+          return false;
+        }
+
+        set.set(0);
+
+        return true;
+      }
+
+      case 'x':
+      {
+        auto const hex = [](char const h) -> int {
+          if (h >= '0' && h <= '9') return h - '0';
+          if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+          if (h >= 'A' && h <= 'F') return h - 'A' + 10;
+          return -1;
+        };
+
+        if (_i + 2 > _rx.size() || hex(_rx[_i]) < 0 || hex(_rx[_i + 1]) < 0)
+        {
+          return false;
+        }
+
+        set = fold(Set().set(static_cast<std::size_t>(hex(_rx[_i]) * 16 + hex(_rx[_i + 1]))));
+        _i += 2;
+
+        return true;
+      }
+
+      default:
+      {
+        // backreferences, unicode, and control escapes are left to std::regex
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        {
+          return false;
+        }
+
+        set = fold(Set().set(static_cast<unsigned char>(c)));
+
+        return true;
+      }
+    }
+  }
+
+  bool klass(Set& set)
+  {
+    bool negate {false};
+
+    if (more() && _rx[_i] == '^')
+    {
+      ++_i;
+      negate = true;
+    }
+
+    // a single char of the class, or a class escape that can not start a range
+    auto const item = [&](Set& val, bool& single) {
+      single = true;
+      val.reset();
+
+      if (_rx[_i] != '\\')
+      {
+        val.set(static_cast<unsigned char>(_rx[_i++]));
+
+        return true;
+      }
+
+      if (++_i >= _rx.size())
+      {
+        return false;
+      }
+
+      auto const e = _rx[_i];
+      single = ! (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S');
+
+      return escape(val, true);
+    };
+
+    while (true)
+    {
+      if (! more())
+      {
+        return false;
+      }
+
+      if (_rx[_i] == ']')
+      {
+        ++_i;
+        break;
+      }
+
+      Set lhs;
+      bool lhs_single {false};
+
+      if (! item(lhs, lhs_single))
+      {
+        return false;
+      }
+
+      // a dash before the closing bracket is a literal dash
+      if (_i + 1 < _rx.size() && _rx[_i] == '-' && _rx[_i + 1] != ']')
+      {
+        ++_i;
+
+        Set rhs;
+        bool rhs_single {false};
+
+        if (! item(rhs, rhs_single) || ! lhs_single || ! rhs_single)
+        {
+          return false;
+        }
+
+        auto const first = first_of(lhs);
+        auto const last = first_of(rhs);
+
+        if (first > last)
+        {
+          return false;
+        }
+
+        set |= range(static_cast<unsigned char>(first), static_cast<unsigned char>(last));
+      }
+      else
+      {
+        set |= lhs;
+      }
+    }
+
+    set = fold(set);
+
+    if (negate)
+    {
+      set.flip();
+    }
+
+    return true;
+  }
+
+  static std::size_t first_of(Set const& set)
+  {
+    for (std::size_t c = 0; c < 256; ++c)
+    {
+      if (set[c])
+      {
+        return c;
+      }
+    }
+
+    return 0;
+  }
+
+  static Set word()
+  {
+    auto set = range('a', 'z') | range('A', 'Z') | range('0', '9');
+    set.set('_');
+
+    return set;
+  }
+
+  static Set space()
+  {
+    return Set().set(' ').set('\t').set('\n').set('\v').set('\f').set('\r');
+  }
+
+  std::string_view _rx;
+  std::size_t _i {0};
+
+  // nesting depth of groups
+  std::size_t _depth {0};
+  static constexpr std::size_t _depth_max {256};
+
+  // max repeat count
+  static constexpr std::size_t _repeat_max {1000};
+};
+
+// instruction of an automaton
+struct Inst
+{
+  enum class Op
+  {
+    set,
+    split,
+    jump,
+    anchor,
+    match,
+  };
+
+  Op op {Op::match};
+
+  // index of the char set consumed
+  std::uint32_t set {0};
+
+  // next instruction, and the lower priority one of a split
+  std::uint32_t x {0};
+  std::uint32_t y {0};
+
+  Anchor anchor {Anchor::begin};
+
+  // consuming the char does not count towards the size of the match,
+  // used by the loop that lets a match start anywhere
+  bool skip {false};
+};
+
+struct Program
+{
+  std::vector<Inst> insts;
+  std::vector<Set> sets;
+  std::uint32_t start {0};
+};
+
+// compile a parsed pattern into a program,
+// reverse compiles it for reading the text backwards,
+// unanchored adds a lowest priority loop so that a match can start anywhere,
+// returns false if the program is too large
+bool compile(Node const& root, bool const reverse, bool const unanchored, Program& prog)
+{
+  std::size_t const insts_max {1 << 16};
+  bool ok {true};
+
+  auto const add = [&](Inst const& inst) {
+    if (prog.insts.size() >= insts_max)
+    {
+      ok = false;
+    }
+
+    prog.insts.emplace_back(inst);
+
+    return static_cast<std::uint32_t>(prog.insts.size() - 1);
+  };
+
+  auto const add_set = [&](Set const& set, std::uint32_t const next, bool const skip) {
+    // repeats copy the same sets over and over
+    if (prog.sets.empty() || prog.sets.back() != set)
+    {
+      prog.sets.emplace_back(set);
+    }
+
+    Inst inst;
+    inst.op = Inst::Op::set;
+    inst.set = static_cast<std::uint32_t>(prog.sets.size() - 1);
+    inst.x = next;
+    inst.skip = skip;
+
+    return add(inst);
+  };
+
+  auto const add_split = [&](std::uint32_t const x, std::uint32_t const y) {
+    Inst inst;
+    inst.op = Inst::Op::split;
+    inst.x = x;
+    inst.y = y;
+
+    return add(inst);
+  };
+
+  // emit the node followed by next, returns the entry of the node
+  auto const emit = [&](auto const& self, Node const& node, std::uint32_t const next) -> std::uint32_t {
+    if (! ok)
+    {
+      return next;
+    }
+
+    switch (node.type)
+    {
+      case Node::Type::empty:
+      {
+        return next;
+      }
+
+      case Node::Type::set:
+      {
+        return add_set(node.set, next, false);
+      }
+
+      case Node::Type::anchor:
+      {
+        Inst inst;
+        inst.op = Inst::Op::anchor;
+        inst.anchor = node.anchor;
+        inst.x = next;
+
+        // read backwards the begin and end of the text swap places
+        if (reverse && node.anchor == Anchor::begin)
+        {
+          inst.anchor = Anchor::end;
+        }
+        else if (reverse && node.anchor == Anchor::end)
+        {
+          inst.anchor = Anchor::begin;
+        }
+
+        return add(inst);
+      }
+
+      case Node::Type::cat:
+      {
+        auto entry = next;
+
+        if (reverse)
+        {
+          for (auto const& e : node.nodes)
+          {
+            entry = self(self, e, entry);
+          }
+        }
+        else
+        {
+          for (auto it = node.nodes.rbegin(); it != node.nodes.rend(); ++it)
+          {
+            entry = self(self, *it, entry);
+          }
+        }
+
+        return entry;
+      }
+
+      case Node::Type::alt:
+      {
+        auto entry = self(self, node.nodes.back(), next);
+
+        for (auto i = node.nodes.size() - 1; i-- > 0;)
+        {
+          entry = add_split(self(self, node.nodes.at(i), next), entry);
+        }
+
+        return entry;
+      }
+
+      case Node::Type::repeat:
+      {
+        auto const& body = node.nodes.front();
+        auto entry = next;
+
+        if (node.max == npos)
+        {
+          auto const loop = add_split(0, 0);
+          auto const first = self(self, body, loop);
+
+          prog.insts.at(loop).x = node.greedy ? first : next;
+          prog.insts.at(loop).y = node.greedy ? next : first;
+          entry = loop;
+        }
+        else
+        {
+          for (auto i = node.min; i < node.max && ok; ++i)
+          {
+            auto const first = self(self, body, entry);
+            entry = node.greedy ? add_split(first, next) : add_split(next, first);
+          }
+        }
+
+        for (std::size_t i = 0; i < node.min && ok; ++i)
+        {
+          entry = self(self, body, entry);
+        }
+
+        return entry;
+      }
+
+      default:
+      {
+        return next;
+      }
+    }
+  };
+
+  Inst match;
+  match.op = Inst::Op::match;
+
+  auto const entry = emit(emit, root, add(match));
+
+  if (unanchored)
+  {
+    auto const any = add_set(Set().set(), 0, true);
+    prog.start = add_split(entry, any);
+    prog.insts.at(any).x = prog.start;
+  }
+  else
+  {
+    prog.start = entry;
+  }
+
+  return ok;
+}
+
+// chars that can start a match, as a string if there are few of them
+std::string first_chars(Set const& set)
+{
+  std::size_t const chars_max {8};
+  std::string chars;
+
+  if (set.count() > chars_max)
+  {
+    return chars;
+  }
+
+  for (std::size_t c = 0; c < 256; ++c)
+  {
+    if (set[c])
+    {
+      chars += static_cast<char>(c);
+    }
+  }
+
+  return chars;
+}
+
+// whether an anchor holds between the previous and next char,
+// next is -1 at the end of the text
+bool holds(Anchor const type, bool const begin, bool const prev_word, int const next)
+{
+  switch (type)
+  {
+    case Anchor::begin:
+      return begin;
+
+    case Anchor::end:
+      return next < 0;
+
+    case Anchor::word:
+    case Anchor::not_word:
+    {
+      auto const next_word = next >= 0 && is_word(static_cast<unsigned char>(next));
+
+      return (prev_word != next_word) == (type == Anchor::word);
+    }
+
+    default:
+      return false;
+  }
+}
+
+// lazily built dfa over the threads of a program,
+// a thread is an instruction index times two plus whether it has consumed a char,
+// each state is a list of threads in priority order, along with whether the
+// previous char is a word char, so that anchors are resolved on the next char,
+// the text reads as if its words were separated by single spaces,
+// whitespace reading as a space and the rest of a run of it as nothing
+class Dfa
+{
+public:
+
+  // longest keeps lower priority threads going after a match
+  Dfa(Program&& prog, bool const longest)
+  {
+    _ctx.prog = std::move(prog);
+    _ctx.longest = longest;
+
+    // split the chars into classes that no set tells apart,
+    // word chars are told apart for the word boundary anchors,
+    // and whitespace for its runs
+    auto sets = _ctx.prog.sets;
+    sets.emplace_back(range('a', 'z') | range('A', 'Z') | range('0', '9') | Set().set('_'));
+    sets.emplace_back(range('\t', '\r').set(' '));
+
+    std::array<std::uint16_t, 512> remap;
+    _ctx.classes.fill(0);
+
+    for (auto const& set : sets)
+    {
+      remap.fill(0xffff);
+      std::uint16_t count {0};
+
+      for (std::size_t c = 0; c < 256; ++c)
+      {
+        auto& id = remap.at(_ctx.classes.at(c) * 2u + (set[c] ? 1u : 0u));
+
+        if (id == 0xffff)
+        {
+          id = count++;
+        }
+
+        _ctx.classes.at(c) = id;
+      }
+
+      _ctx.count = count;
+    }
+
+    for (unsigned char c = '\t'; c <= '\r'; ++c)
+    {
+      _ctx.classes.at(c) = _ctx.classes.at(' ');
+    }
+
+    for (std::size_t c = 256; c-- > 0;)
+    {
+      _ctx.chars.at(_ctx.classes.at(c)) = static_cast<unsigned char>(c);
+    }
+
+    _ctx.chars.at(_ctx.classes.at(' ')) = ' ';
+
+    // one more column for the end of the text
+    _ctx.stride = _ctx.count + 1;
+
+    _ctx.seen.assign(_ctx.prog.insts.size() * 2, 0);
+    _ctx.added.assign(_ctx.prog.insts.size() * 2, 0);
+
+    // an unanchored start state loops back to itself until a match can start,
+    // so the chars that can not start a match are skipped over
+    auto const& start = _ctx.prog.insts.at(_ctx.prog.start);
+
+    if (start.op == Inst::Op::split && _ctx.prog.insts.at(start.y).skip)
+    {
+      Set first;
+      std::vector<bool> seen (_ctx.prog.insts.size(), false);
+      std::vector<std::uint32_t> stack {start.x};
+
+      while (! stack.empty())
+      {
+        auto const pc = stack.back();
+        stack.pop_back();
+
+        if (seen.at(pc))
+        {
+          continue;
+        }
+
+        seen.at(pc) = true;
+        auto const& inst = _ctx.prog.insts.at(pc);
+
+        switch (inst.op)
+        {
+          case Inst::Op::set:
+            first |= _ctx.prog.sets.at(inst.set);
+            break;
+
+          case Inst::Op::split:
+            stack.emplace_back(inst.y);
+            stack.emplace_back(inst.x);
+            break;
+
+          case Inst::Op::jump:
+          case Inst::Op::anchor:
+            stack.emplace_back(inst.x);
+            break;
+
+          case Inst::Op::match:
+          default:
+            break;
+        }
+      }
+
+      // whitespace reads as a space
+      for (unsigned char c = '\t'; c <= '\r'; ++c)
+      {
+        first.set(c, first[' ']);
+      }
+
+      // few chars are searched for directly, more are looked up in a table
+      if (first.count() <= _ctx.skip_max)
+      {
+        _ctx.skip = true;
+        _ctx.first = first_chars(first);
+
+        for (std::size_t c = 0; c < 256; ++c)
+        {
+          _ctx.table.at(c) = first[c];
+        }
+      }
+    }
+
+    reset();
+  }
+
+  // read str forwards from offset i, with no new match starting from offset limit on,
+  // returns the end of the last match before the dfa dies or npos,
+  // or npos once stop is set
+  std::size_t forward(std::string_view const str, std::size_t i, std::size_t const limit,
+    std::atomic<bool> const* stop)
+  {
+    auto const size = str.size();
+    auto const* ptr = reinterpret_cast<unsigned char const*>(str.data());
+    auto res = npos;
+    bool limited {false};
+
+    auto state = _ctx.start.at(i ? flags(ptr[i - 1]) : begin);
+    _ctx.block.pos = npos;
+
+    while (i < size)
+    {
+      if (stop && stop->load(std::memory_order_relaxed))
+      {
+        return npos;
+      }
+
+      if (i >= limit && ! limited)
+      {
+        limited = true;
+        state = strip(state);
+
+        if (state == _ctx.dead)
+        {
+          return res;
+        }
+      }
+
+      // look at stop again after at most check_size chars,
+      // and at limit once it is reached
+      auto const bound = std::min({size, i + check_size, limited ? size : limit});
+
+      if (_ctx.skip && (state == _ctx.start.at(0) || state == _ctx.start.at(word) ||
+        state == _ctx.start.at(begin) || state == _ctx.start.at(space)))
+      {
+        if (auto const next = skip(str, i, bound); next != i)
+        {
+          i = next;
+
+          if (i < size)
+          {
+            state = _ctx.start.at(flags(ptr[i - 1]));
+          }
+
+          continue;
+        }
+      }
+
+      auto const* trans = _ctx.trans.data();
+      auto const* classes = _ctx.classes.data();
+      std::uint32_t next {0};
+
+      // stay on the fast path until a transition is tagged
+      for (; i < bound; ++i)
+      {
+        if ((next = trans[state + classes[ptr[i]]]) >= special)
+        {
+          break;
+        }
+
+        state = next;
+      }
+
+      if (i == bound)
+      {
+        continue;
+      }
+
+      if (next == unknown)
+      {
+        next = step(state, classes[ptr[i]]);
+      }
+
+      // a match ends before the char
+      if (next & matched)
+      {
+        res = i;
+      }
+
+      state = next & ~tags;
+      ++i;
+
+      if (state == _ctx.dead)
+      {
+        return res;
+      }
+    }
+
+    if (entry(state, _ctx.count) & matched)
+    {
+      res = size;
+    }
+
+    return res;
+  }
+
+  // read str backwards from offset i down to offset begin,
+  // the chars around the range are seen by anchors,
+  // returns the start of the last match before the dfa dies or npos
+  std::size_t backward(std::string_view const str, std::size_t i, std::size_t const end)
+  {
+    auto const* ptr = reinterpret_cast<unsigned char const*>(str.data());
+    auto res = npos;
+
+    auto state = _ctx.start.at(i < str.size() ? flags(ptr[i]) : begin);
+
+    for (; i > end; --i)
+    {
+      auto const next = entry(state, _ctx.classes[ptr[i - 1]]);
+
+      if (next & matched)
+      {
+        res = i;
+      }
+
+      state = next & ~tags;
+
+      if (state == _ctx.dead)
+      {
+        return res;
+      }
+    }
+
+    if (entry(state, end ? _ctx.classes[ptr[end - 1]] : _ctx.count) & matched)
+    {
+      res = end;
+    }
+
+    return res;
+  }
+
+private:
+
+  // state flags
+  static constexpr std::uint8_t word {1};
+  static constexpr std::uint8_t begin {2};
+  static constexpr std::uint8_t space {4};
+
+  // tags of a transition, the states are offsets into the transitions
+  static constexpr std::uint32_t matched {0x80000000};
+  static constexpr std::uint32_t special {0x40000000};
+  static constexpr std::uint32_t tags {matched | special};
+  static constexpr std::uint32_t unknown {0xffffffff};
+
+  static std::uint8_t flags(unsigned char const c)
+  {
+    return is_word(c) ? word : is_space(c) ? space : 0;
+  }
+
+  // offset of the next char from offset i that can start a match,
+  // or an offset from bound on when there is none before bound
+  std::size_t skip(std::string_view const str, std::size_t const i, std::size_t const bound)
+  {
+    auto const res = find_first(str, i, bound);
+
+    // stop skipping once the chars that can start a match turn out to be
+    // too frequent for it to pay off
+    _ctx.skips += 1;
+    _ctx.skipped += res - i;
+
+    if (_ctx.skips >= _ctx.skips_min && _ctx.skipped < _ctx.skips * _ctx.skip_dist)
+    {
+      _ctx.skip = false;
+
+      for (auto& next : _ctx.trans)
+      {
+        if (next != unknown && (next & ~tags) != _ctx.dead)
+        {
+          next &= ~special;
+        }
+      }
+    }
+
+    return res;
+  }
+
+  std::size_t find_first(std::string_view const str, std::size_t i, std::size_t const bound)
+  {
+    if (! _ctx.first.empty())
+    {
+      auto& block = _ctx.block;
+
+      // frequent chars land in the same block over and over
+      if (block.pos != npos && i >= block.pos && i - block.pos < 64)
+      {
+        if (auto const mask = block.mask >> (i - block.pos))
+        {
+          return i + static_cast<std::size_t>(__builtin_ctzll(mask));
+        }
+
+        i = block.pos + 64;
+      }
+
+      for (; i < bound; i += 64)
+      {
+        block.pos = i;
+        block.mask = Text::char_mask(str.data() + i, std::min(str.size() - i, std::size_t {64}), _ctx.first);
+
+        if (block.mask)
+        {
+          return i + static_cast<std::size_t>(__builtin_ctzll(block.mask));
+        }
+      }
+
+      return std::min(i, str.size());
+    }
+
+    auto const* ptr = reinterpret_cast<unsigned char const*>(str.data());
+    auto const* table = _ctx.table.data();
+
+    for (; i < bound; ++i)
+    {
+      if (table[ptr[i]])
+      {
+        return i;
+      }
+    }
+
+    return bound;
+  }
+
+  // state without the thread of the lowest priority loop that lets a match start anywhere,
+  // so that no new match starts from it on
+  std::uint32_t strip(std::uint32_t const state)
+  {
+    auto const& src = _ctx.states.at(state / _ctx.stride);
+    auto const loop = _ctx.prog.start * 2;
+
+    std::vector<std::uint32_t> threads;
+
+    for (auto const thread : src.threads)
+    {
+      if (thread != loop)
+      {
+        threads.emplace_back(thread);
+      }
+    }
+
+    return add(std::move(threads), src.flags);
+  }
+
+  std::uint32_t entry(std::uint32_t const state, std::size_t const col)
+  {
+    auto const res = _ctx.trans[state + col];
+
+    return res != unknown ? res : step(state, col);
+  }
+
+  // build the transition from state on a char of class col,
+  // or at the end of the text for the last column
+  std::uint32_t step(std::uint32_t const state, std::size_t const col)
+  {
+    auto const next = col < _ctx.count ? int {_ctx.chars.at(col)} : -1;
+    auto const& src = _ctx.states.at(state / _ctx.stride);
+
+    // the rest of a run of whitespace, the match ending before it
+    // is seen on the char after the run
+    if (next == ' ' && (src.flags & space))
+    {
+      auto const res = tag(state, false);
+      _ctx.trans.at(state + col) = res;
+
+      return res;
+    }
+
+    mark();
+
+    std::vector<std::uint32_t> threads;
+    bool match {false};
+
+    for (auto const thread : src.threads)
+    {
+      if (! closure(thread, src.flags, next, threads, match))
+      {
+        break;
+      }
+    }
+
+    auto const flags = next >= 0 ? Dfa::flags(static_cast<unsigned char>(next)) : std::uint8_t {0};
+
+    // start over when the states take up too much memory
+    if (_ctx.states.size() >= _ctx.states_max)
+    {
+      reset();
+
+      return tag(add(std::move(threads), flags), match);
+    }
+
+    auto const res = tag(add(std::move(threads), flags), match);
+    _ctx.trans.at(state + col) = res;
+
+    return res;
+  }
+
+  std::uint32_t tag(std::uint32_t const state, bool const match) const
+  {
+    auto res = state;
+
+    if (match)
+    {
+      res |= matched;
+    }
+
+    if (state == _ctx.dead || (_ctx.skip &&
+      (state == _ctx.start.at(0) || state == _ctx.start.at(word) || state == _ctx.start.at(space))))
+    {
+      res |= special;
+    }
+
+    return res;
+  }
+
+  // follow thread without consuming a char, resolving anchors on the next char,
+  // then add the threads that consume the next char,
+  // returns false once a match cuts off the lower priority threads
+  bool closure(std::uint32_t const thread, std::uint8_t const flags, int const next,
+    std::vector<std::uint32_t>& threads, bool& match)
+  {
+    auto& stack = _ctx.stack;
+    stack.clear();
+    stack.emplace_back(thread);
+
+    while (! stack.empty())
+    {
+      auto const top = stack.back();
+      stack.pop_back();
+
+      if (_ctx.seen[top] == _ctx.gen)
+      {
+        continue;
+      }
+
+      _ctx.seen[top] = _ctx.gen;
+
+      auto const& inst = _ctx.prog.insts[top / 2];
+      auto const flag = top & 1;
+
+      switch (inst.op)
+      {
+        case Inst::Op::set:
+        {
+          if (next >= 0 && _ctx.prog.sets[inst.set][static_cast<std::size_t>(next)])
+          {
+            auto const res = inst.x * 2 + (inst.skip ? 0 : 1);
+
+            if (_ctx.added[res] != _ctx.gen)
+            {
+              _ctx.added[res] = _ctx.gen;
+              threads.emplace_back(res);
+            }
+          }
+
+          break;
+        }
+
+        case Inst::Op::split:
+          stack.emplace_back(inst.y * 2 + flag);
+          stack.emplace_back(inst.x * 2 + flag);
+          break;
+
+        case Inst::Op::jump:
+          stack.emplace_back(inst.x * 2 + flag);
+          break;
+
+        case Inst::Op::anchor:
+        {
+          if (holds(inst.anchor, flags & begin, flags & word, next))
+          {
+            stack.emplace_back(inst.x * 2 + flag);
+          }
+
+          break;
+        }
+
+        case Inst::Op::match:
+        {
+          // empty matches do not count
+          if (flag)
+          {
+            match = true;
+
+            if (! _ctx.longest)
+            {
+              return false;
+            }
+          }
+
+          break;
+        }
+
+        default:
+          break;
+      }
+    }
+
+    return true;
+  }
+
+  // start a new generation of seen threads
+  void mark()
+  {
+    if (++_ctx.gen == 0)
+    {
+      std::fill(_ctx.seen.begin(), _ctx.seen.end(), 0);
+      std::fill(_ctx.added.begin(), _ctx.added.end(), 0);
+      _ctx.gen = 1;
+    }
+  }
+
+  std::uint32_t add(std::vector<std::uint32_t>&& threads, std::uint8_t const flags)
+  {
+    if (threads.empty() && ! _ctx.states.empty())
+    {
+      return _ctx.dead;
+    }
+
+    auto key = std::make_pair(std::move(threads), flags);
+    auto const it = _ctx.ids.find(key);
+
+    if (it != _ctx.ids.end())
+    {
+      return it->second;
+    }
+
+    auto const id = static_cast<std::uint32_t>(_ctx.states.size() * _ctx.stride);
+    _ctx.states.emplace_back(State {key.first, flags});
+    _ctx.trans.resize(_ctx.trans.size() + _ctx.stride, unknown);
+    _ctx.ids.emplace(std::move(key), id);
+
+    return id;
+  }
+
+  // drop all states except the dead and start states
+  void reset()
+  {
+    _ctx.states.clear();
+    _ctx.trans.clear();
+    _ctx.ids.clear();
+
+    _ctx.dead = add({}, 0);
+
+    for (std::uint8_t flags = 0; flags < _ctx.start.size(); ++flags)
+    {
+      _ctx.start.at(flags) = add({_ctx.prog.start * 2}, flags);
+    }
+  }
+
+  struct State
+  {
+    std::vector<std::uint32_t> threads;
+    std::uint8_t flags {0};
+  };
+
+  struct Ctx
+  {
+    Program prog;
+    bool longest {false};
+
+    // char class of each char, and a char of each class
+    std::array<std::uint16_t, 256> classes {};
+    std::array<unsigned char, 256> chars {};
+    std::size_t count {1};
+
+    // transitions per state, a column per char class and one for the end of the text
+    std::size_t stride {2};
+
+    std::vector<State> states;
+    std::map<std::pair<std::vector<std::uint32_t>, std::uint8_t>, std::uint32_t> ids;
+
+    // next state of each state and column, tagged
+    std::vector<std::uint32_t> trans;
+
+    std::uint32_t dead {0};
+
+    // start state for each of the state flags
+    std::array<std::uint32_t, 5> start {};
+
+    // max number of states before they are dropped
+    std::size_t const states_max {4096};
+
+    // chars that can start a match, skipped to from the start state,
+    // as a string if there are few of them, and as a table
+    bool skip {false};
+    std::string first;
+    std::array<bool, 256> table {};
+
+    // mask of the chars that can start a match in the last block searched
+    struct Block
+    {
+      std::size_t pos {npos};
+      std::uint64_t mask {0};
+    } block;
+
+    // max number of chars that can start a match for them to be skipped to
+    std::size_t const skip_max {32};
+
+    // number of skips and chars skipped,
+    // skipping stops after the min number of skips if the average is below skip_dist
+    std::size_t skips {0};
+    std::size_t skipped {0};
+    std::size_t const skips_min {4096};
+    std::size_t const skip_dist {16};
+
+    // generation in which each thread was last followed and added
+    std::vector<std::uint32_t> seen;
+    std::vector<std::uint32_t> added;
+    std::uint32_t gen {0};
+
+    std::vector<std::uint32_t> stack;
+  } _ctx;
+};
+
+// literal string compared case-insensitively,
+// or a phrase of them, each after a run of whitespace
+class Literal : public Pattern::Engine
+{
+public:
+
+  explicit Literal(std::string&& str) :
+    Literal(std::vector<std::string> {std::move(str)})
+  {
+  }
+
+  explicit Literal(std::vector<std::string>&& words)
+  {
+    _ctx.str = std::move(words.front());
+    _ctx.rest.assign(std::make_move_iterator(words.begin() + 1), std::make_move_iterator(words.end()));
+
+    auto const c = static_cast<unsigned char>(_ctx.str.front());
+    _ctx.first = std::string(1, static_cast<char>(c));
+
+    if (c >= 'a' && c <= 'z')
+    {
+      _ctx.first += static_cast<char>(c - 32);
+    }
+  }
+
+  bool find(std::string_view const str, std::size_t pos, std::size_t const limit, Pattern::Match& match) override
+  {
+    if (_ctx.rest.empty())
+    {
+      return find_str(str, pos, limit, match);
+    }
+
+    // the first word, followed by the rest
+    while (find_str(str, pos, limit, match))
+    {
+      if (follow(str, match))
+      {
+        return true;
+      }
+
+      pos = match.begin + 1;
+    }
+
+    return false;
+  }
+
+  std::unique_ptr<Pattern::Engine> clone() const override
+  {
+    return std::make_unique<Literal>(*this);
+  }
+
+  std::string_view name() const override
+  {
+    return "literal";
+  }
+
+private:
+
+  bool find_str(std::string_view const str, std::size_t pos, std::size_t const limit, Pattern::Match& match) const
+  {
+    auto const size = _ctx.str.size();
+
+    if (size == 1)
+    {
+      return find_char(str.substr(0, std::min(str.size(), limit)), pos, match);
+    }
+
+    // chars at the first and last offsets of the string are compared
+    // for 64 offsets at a time, the chars in between only where both match
+    auto const* ptr = str.data();
+    auto const first = _ctx.str.front();
+    auto const last = _ctx.str.back();
+
+    // past the last offset a match can start at
+    auto const end = str.size() < size ? 0 : std::min(str.size() - size + 1, limit);
+
+    while (pos < end)
+    {
+      if (stop && stop->load(std::memory_order_relaxed))
+      {
+        return false;
+      }
+
+      // look at stop again after at most check_size offsets
+      auto const bound = std::min(end, pos + check_size);
+
+      for (; pos + 64 <= bound; pos += 64)
+      {
+        for (auto mask = Text::pair_mask(ptr + pos, size - 1, first, last); mask; mask &= mask - 1)
+        {
+          auto const i = pos + static_cast<std::size_t>(__builtin_ctzll(mask));
+
+          if (equal(str, i, 1, size - 1))
+          {
+            match = {i, i + size};
+
+            return true;
+          }
+        }
+      }
+
+      for (; pos < bound; ++pos)
+      {
+        if (equal(str, pos, 0, size))
+        {
+          match = {pos, pos + size};
+
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  // extend the match of the first word by the rest of the phrase
+  bool follow(std::string_view const str, Pattern::Match& match) const
+  {
+    auto i = match.end;
+
+    for (auto const& word : _ctx.rest)
+    {
+      if (i >= str.size() || ! is_space(static_cast<unsigned char>(str[i])))
+      {
+        return false;
+      }
+
+      while (i < str.size() && is_space(static_cast<unsigned char>(str[i])))
+      {
+        ++i;
+      }
+
+      if (str.size() - i < word.size())
+      {
+        return false;
+      }
+
+      for (auto const c : word)
+      {
+        if (lower(static_cast<unsigned char>(str[i++])) != static_cast<unsigned char>(c))
+        {
+          return false;
+        }
+      }
+    }
+
+    match.end = i;
+
+    return true;
+  }
+
+  // the chars of the string in [begin, end) are at offset pos in str
+  bool equal(std::string_view const str, std::size_t const pos, std::size_t const begin, std::size_t const end) const
+  {
+    for (auto i = begin; i < end; ++i)
+    {
+      if (lower(static_cast<unsigned char>(str[pos + i])) != static_cast<unsigned char>(_ctx.str[i]))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // find a single char
+  bool find_char(std::string_view const str, std::size_t pos, Pattern::Match& match) const
+  {
+    while (pos < str.size())
+    {
+      if (stop && stop->load(std::memory_order_relaxed))
+      {
+        return false;
+      }
+
+      // look at stop again after at most check_size chars
+      auto const bound = std::min(str.size(), pos + check_size);
+
+      if (auto const i = Text::find_any(str.substr(0, bound), pos, _ctx.first); i != npos)
+      {
+        match = {i, i + 1};
+
+        return true;
+      }
+
+      pos = bound;
+    }
+
+    return false;
+  }
+
+  struct Ctx
+  {
+    // lowercase string
+    std::string str;
+
+    // both cases of the first char
+    std::string first;
+
+    // lowercase words after the first of a phrase
+    std::vector<std::string> rest;
+  } _ctx;
+};
+
+// set of literal strings compared case-insensitively,
+// all found in one pass by an aho-corasick automaton,
+// whitespace in a string matches a run of whitespace, read as a single space
+class Strings : public Pattern::Engine
+{
+public:
+
+  explicit Strings(std::vector<std::string> const& strs_)
+  {
+    std::vector<std::string> strs;
+    strs.reserve(strs_.size());
+
+    for (auto const& str : strs_)
+    {
+      auto& res = strs.emplace_back();
+
+      for (auto const c : str)
+      {
+        if (! is_space(static_cast<unsigned char>(c)))
+        {
+          res += c;
+        }
+        else if (res.empty() || res.back() != ' ')
+        {
+          res += ' ';
+          _ctx.spaces = true;
+        }
+      }
+    }
+
+    // each char of the strings has a class shared with its other case,
+    // and whitespace with a space, all other chars are in class 0
+    auto& classes = _ctx.classes;
+    std::uint32_t count {1};
+
+    for (auto const& str : strs)
+    {
+      for (auto const c : str)
+      {
+        auto const l = lower(static_cast<unsigned char>(c));
+
+        if (! classes.at(l))
+        {
+          classes.at(l) = count++;
+        }
+      }
+    }
+
+    for (unsigned char c = 'A'; c <= 'Z'; ++c)
+    {
+      classes.at(c) = classes.at(c + 32);
+    }
+
+    for (unsigned char c = '\t'; c <= '\r'; ++c)
+    {
+      classes.at(c) = classes.at(' ');
+    }
+
+    // trie of the strings, node n has its transitions at n * count,
+    // a transition to node 0 means there is none yet
+    std::vector<std::uint32_t> trans(count, 0);
+    std::vector<std::uint32_t> depth {0};
+
+    // size of the longest string ending at each node
+    std::vector<std::uint32_t> out {0};
+
+    for (auto const& str : strs)
+    {
+      std::uint32_t node {0};
+
+      for (auto const c : str)
+      {
+        auto const i = node * count + classes.at(static_cast<unsigned char>(c));
+
+        if (! trans.at(i))
+        {
+          trans.at(i) = static_cast<std::uint32_t>(depth.size());
+          trans.resize(trans.size() + count, 0);
+          depth.emplace_back(depth.at(node) + 1);
+          out.emplace_back(0);
+        }
+
+        node = trans.at(i);
+      }
+
+      out.at(node) = depth.at(node);
+    }
+
+    if (depth.size() * count >= matched)
+    {
+      throw std::length_error("set too large");
+    }
+
+    // turn the trie into an automaton breadth first,
+    // a missing transition follows the failure link of the node,
+    // the longest proper suffix of it that is also in the trie
+    std::vector<std::uint32_t> fail(depth.size(), 0);
+    std::vector<std::uint32_t> queue;
+
+    for (std::uint32_t c = 0; c < count; ++c)
+    {
+      if (auto const next = trans.at(c))
+      {
+        queue.emplace_back(next);
+      }
+    }
+
+    for (std::size_t q = 0; q < queue.size(); ++q)
+    {
+      auto const node = queue.at(q);
+
+      for (std::uint32_t c = 0; c < count; ++c)
+      {
+        auto const i = node * count + c;
+        auto const link = trans.at(fail.at(node) * count + c);
+
+        if (auto const next = trans.at(i))
+        {
+          fail.at(next) = link;
+
+          if (! out.at(next))
+          {
+            out.at(next) = out.at(link);
+          }
+
+          queue.emplace_back(next);
+        }
+        else
+        {
+          trans.at(i) = link;
+        }
+      }
+    }
+
+    // transitions hold the offset of their node,
+    // tagged when a string ends at it
+    for (auto& e : trans)
+    {
+      e = (e * count) | (out.at(e) ? matched : 0);
+    }
+
+    for (std::size_t c = 0; c < 256; ++c)
+    {
+      _ctx.first.at(c) = trans.at(classes.at(c)) != 0;
+    }
+
+    if (_ctx.spaces)
+    {
+      std::size_t size {1};
+
+      while (size <= *std::max_element(depth.begin(), depth.end()))
+      {
+        size <<= 1;
+      }
+
+      _ctx.starts.resize(size);
+    }
+
+    _ctx.trans = std::move(trans);
+    _ctx.depth = std::move(depth);
+    _ctx.out = std::move(out);
+    _ctx.count = count;
+  }
+
+  bool find(std::string_view const str, std::size_t const pos, std::size_t const limit, Pattern::Match& match) override
+  {
+    return _ctx.spaces ? search<true>(str, pos, limit, match) : search<false>(str, pos, limit, match);
+  }
+
+  std::unique_ptr<Pattern::Engine> clone() const override
+  {
+    return std::make_unique<Strings>(*this);
+  }
+
+  std::string_view name() const override
+  {
+    return "set";
+  }
+
+private:
+
+  static std::uint32_t const matched {0x80000000};
+
+  // with spaces, the chars read are no longer those of the string,
+  // so the offset each one starts at is kept
+  template<bool spaces>
+  bool search(std::string_view const str, std::size_t pos, std::size_t const limit, Pattern::Match& match)
+  {
+    auto const size = str.size();
+    auto const* ptr = reinterpret_cast<unsigned char const*>(str.data());
+    auto const* trans = _ctx.trans.data();
+    auto const* classes = _ctx.classes.data();
+    auto const* depth = _ctx.depth.data();
+    auto* starts = _ctx.starts.data();
+    auto const mask = _ctx.starts.size() - 1;
+    std::uint32_t state {0};
+
+    // number of chars read, a run of whitespace being one
+    std::size_t count {0};
+
+    while (pos < size)
+    {
+      if (stop && stop->load(std::memory_order_relaxed))
+      {
+        return false;
+      }
+
+      // look at stop again after at most check_size chars
+      auto const bound = std::min(size, pos + check_size);
+
+      for (; pos < bound; ++pos)
+      {
+        // past limit, the string read so far starts at or past it
+        if (pos >= limit)
+        {
+          auto const read = depth[state / _ctx.count];
+
+          if (spaces ? ! read || starts[(count - read) & mask] >= limit : pos - read >= limit)
+          {
+            return false;
+          }
+        }
+
+        // skip the chars that can not start a string
+        if (! state && ! _ctx.first[ptr[pos]])
+        {
+          continue;
+        }
+
+        if constexpr (spaces)
+        {
+          // the rest of a run of whitespace, which may have started before pos
+          if (pos && is_space(ptr[pos]) && is_space(ptr[pos - 1]))
+          {
+            continue;
+          }
+
+          starts[count++ & mask] = pos;
+        }
+
+        auto const next = trans[state + classes[ptr[pos]]];
+        state = next & ~matched;
+
+        // the string ending first, and the longest one ending there
+        if (next & matched)
+        {
+          auto const len = _ctx.out[state / _ctx.count];
+
+          if constexpr (spaces)
+          {
+            // a string ending in whitespace takes the whole run
+            auto end = pos + 1;
+
+            if (is_space(ptr[pos]))
+            {
+              while (end < size && is_space(ptr[end]))
+              {
+                ++end;
+              }
+            }
+
+            match = {starts[(count - len) & mask], end};
+          }
+          else
+          {
+            match = {pos + 1 - len, pos + 1};
+          }
+
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  struct Ctx
+  {
+    // char classes
+    std::array<std::uint32_t, 256> classes {};
+    std::uint32_t count {0};
+
+    // transitions of each node by char class
+    std::vector<std::uint32_t> trans;
+
+    // size of the string read to reach each node
+    std::vector<std::uint32_t> depth;
+
+    // size of the longest string ending at each node
+    std::vector<std::uint32_t> out;
+
+    // chars that can start a string
+    std::array<bool, 256> first {};
+
+    // a string has whitespace
+    bool spaces {false};
+
+    // offsets of the last chars read, a power of 2 above the size of the longest string
+    std::vector<std::size_t> starts;
+  } _ctx;
+};
+
+// plain text string within a number of edits of a whole word of the text,
+// a word being a run of non-whitespace chars less its leading and trailing punctuation,
+// or each part of it up to a max width,
+// compared case-insensitively, the edit distances of every prefix of the string
+// to the word are kept as bit vectors of their differences, and updated a char at a time
+class Fuzzy : public Pattern::Engine
+{
+public:
+
+  // max size of the string matched with edits, the number of bits in a bit vector
+  static constexpr std::size_t size_max {64};
+
+  Fuzzy(std::string&& str, std::size_t const dist, std::size_t const width)
+  {
+    _ctx.str = std::move(str);
+    _ctx.dist = dist;
+    _ctx.width = width;
+
+    if (! dist)
+    {
+      return;
+    }
+
+    // bit i is set for the chars equal to char i of the string
+    for (std::size_t i = 0; i < _ctx.str.size(); ++i)
+    {
+      auto const c = static_cast<unsigned char>(_ctx.str[i]);
+      auto const bit = std::uint64_t {1} << i;
+
+      _ctx.eq.at(c) |= bit;
+
+      if (c >= 'a' && c <= 'z')
+      {
+        _ctx.eq.at(c - 32u) |= bit;
+      }
+    }
+  }
+
+  bool find(std::string_view const str, std::size_t pos, std::size_t const limit, Pattern::Match& match) override
+  {
+    auto const size = str.size();
+
+    // a word started before pos is not whole,
+    // with a max width the search goes on from the next part of it,
+    // which is at pos when the last match ended there
+    if (pos && pos < size && ! is_space(static_cast<unsigned char>(str[pos - 1])))
+    {
+      if (! _ctx.width)
+      {
+        while (pos < size && ! is_space(static_cast<unsigned char>(str[pos])))
+        {
+          ++pos;
+        }
+      }
+      else if (str.data() != _ctx.last.data() || str.size() != _ctx.last.size() || pos != _ctx.last_end)
+      {
+        auto begin = pos;
+
+        while (begin && ! is_space(static_cast<unsigned char>(str[begin - 1])))
+        {
+          --begin;
+        }
+
+        auto const next = begin + (pos - begin + _ctx.width - 1) / _ctx.width * _ctx.width;
+
+        while (pos < next && pos < size && ! is_space(static_cast<unsigned char>(str[pos])))
+        {
+          ++pos;
+        }
+      }
+    }
+
+    for (auto check = pos; pos < size;)
+    {
+      if (! is_space(static_cast<unsigned char>(str[pos])))
+      {
+        if (pos >= limit)
+        {
+          return false;
+        }
+
+        // look at stop again after at most check_size chars
+        if (pos >= check)
+        {
+          if (stop && stop->load(std::memory_order_relaxed))
+          {
+            return false;
+          }
+
+          check = pos + check_size;
+        }
+
+        // the word, or the part of it up to the max width,
+        // the next part being read as a word of its own
+        auto const begin = pos;
+
+        while (pos < size && ! is_space(static_cast<unsigned char>(str[pos])) &&
+          (! _ctx.width || pos - begin < _ctx.width))
+        {
+          ++pos;
+        }
+
+        auto first = begin;
+        auto last = pos;
+
+        while (first < last && is_punct(static_cast<unsigned char>(str[first])))
+        {
+          ++first;
+        }
+
+        while (last > first && is_punct(static_cast<unsigned char>(str[last - 1])))
+        {
+          --last;
+        }
+
+        if (first < last && within(str.substr(first, last - first)))
+        {
+          match = {begin, pos};
+          _ctx.last = str;
+          _ctx.last_end = pos;
+
+          return true;
+        }
+      }
+      else
+      {
+        ++pos;
+      }
+    }
+
+    return false;
+  }
+
+  std::unique_ptr<Pattern::Engine> clone() const override
+  {
+    return std::make_unique<Fuzzy>(*this);
+  }
+
+  std::string_view name() const override
+  {
+    return "fuzzy";
+  }
+
+private:
+
+  // whether word is within dist edits of the string
+  bool within(std::string_view const word) const
+  {
+    auto const size = _ctx.str.size();
+    auto const dist = _ctx.dist;
+
+    if ((word.size() > size ? word.size() - size : size - word.size()) > dist)
+    {
+      return false;
+    }
+
+    if (! dist)
+    {
+      return std::equal(word.begin(), word.end(), _ctx.str.begin(), [](char const lhs, char const rhs) {
+        return lower(static_cast<unsigned char>(lhs)) == static_cast<unsigned char>(rhs);
+      });
+    }
+
+    auto const high = std::uint64_t {1} << (size - 1);
+
+    // differences between the distances of consecutive prefixes of the string,
+    // positive and negative, and the distance of the whole string
+    std::uint64_t pv {~std::uint64_t {0}};
+    std::uint64_t mv {0};
+    auto score = size;
+
+    for (auto const c : word)
+    {
+      auto const e = _ctx.eq[static_cast<unsigned char>(c)];
+      auto const xv = e | mv;
+      auto const xh = (((e & pv) + pv) ^ pv) | e;
+      auto ph = mv | ~(xh | pv);
+      auto mh = pv & xh;
+
+      if (ph & high)
+      {
+        ++score;
+      }
+      else if (mh & high)
+      {
+        --score;
+      }
+
+      // the whole word is matched, so the distance to the empty prefix goes up by one
+      ph = (ph << 1) | 1;
+      mh <<= 1;
+      pv = mh | ~(xv | ph);
+      mv = ph & xv;
+    }
+
+    return score <= dist;
+  }
+
+  struct Ctx
+  {
+    // lowercase string
+    std::string str;
+
+    // max number of edits
+    std::size_t dist {0};
+
+    // max size of a part of a word, 0 for whole words
+    std::size_t width {0};
+
+    // text searched and the offset the last match in it ended at
+    std::string_view last;
+    std::size_t last_end {0};
+
+    // bit vector of the offsets in the string of each char
+    std::array<std::uint64_t, 256> eq {};
+  } _ctx;
+};
+
+// regular pattern,
+// a forward dfa finds where the leftmost match ends,
+// then a reverse dfa finds where it starts
+class Automaton : public Pattern::Engine
+{
+public:
+
+  Automaton(Program&& forward, Program&& reverse) :
+    _ctx {Dfa(std::move(forward), false), Dfa(std::move(reverse), true)}
+  {
+  }
+
+  bool find(std::string_view const str, std::size_t const pos, std::size_t const limit, Pattern::Match& match) override
+  {
+    auto const end = _ctx.forward.forward(str, pos, limit, stop);
+
+    if (end == npos)
+    {
+      return false;
+    }
+
+    // the longest match ending at end starts where the leftmost match starts
+    auto const begin = _ctx.reverse.backward(str, end, pos);
+
+    if (begin == npos)
+    {
+      return false;
+    }
+
+    match = {begin, end};
+
+    return true;
+  }
+
+  std::unique_ptr<Pattern::Engine> clone() const override
+  {
+    return std::make_unique<Automaton>(*this);
+  }
+
+  std::string_view name() const override
+  {
+    return "dfa";
+  }
+
+private:
+
+  struct Ctx
+  {
+    Dfa forward;
+    Dfa reverse;
+  } _ctx;
+};
+
+// backtracking std::regex, for patterns beyond the regular subset,
+// reading the text the way the dfa does, whitespace as a space and the rest of a run of it as nothing
+class Backtrack : public Pattern::Engine
+{
+public:
+
+  explicit Backtrack(std::string const& rx) :
+    _ctx {std::regex(rx, std::regex::optimize | std::regex::icase)}
+  {
+  }
+
+  bool find(std::string_view const str, std::size_t const pos, std::size_t const, Pattern::Match& match) override
+  {
+    auto const* begin = str.data();
+    auto const* end = begin + str.size();
+    auto const* ptr = begin + pos;
+
+    // a search from within a run of whitespace starts after it
+    if (pos && is_space(static_cast<unsigned char>(ptr[-1])))
+    {
+      while (ptr < end && is_space(static_cast<unsigned char>(*ptr)))
+      {
+        ++ptr;
+      }
+    }
+
+    auto flags = std::regex_constants::match_not_null;
+
+    if (ptr != begin)
+    {
+      flags |= std::regex_constants::match_prev_avail;
+    }
+
+    std::match_results<Chars> res;
+
+    if (! std::regex_search(Chars(ptr, begin, end), Chars(end, begin, end), res, _ctx.rgx, flags))
+    {
+      return false;
+    }
+
+    match.begin = static_cast<std::size_t>(res[0].first.base() - begin);
+    match.end = static_cast<std::size_t>(res[0].second.base() - begin);
+
+    return true;
+  }
+
+  std::unique_ptr<Pattern::Engine> clone() const override
+  {
+    return std::make_unique<Backtrack>(*this);
+  }
+
+  std::string_view name() const override
+  {
+    return "regex";
+  }
+
+private:
+
+  // chars of the text with each run of whitespace read as a single space
+  class Chars
+  {
+  public:
+
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = char const*;
+    using reference = char;
+
+    Chars() = default;
+
+    Chars(char const* ptr, char const* begin, char const* end) :
+      _ptr {ptr},
+      _begin {begin},
+      _end {end}
+    {
+    }
+
+    char operator*() const
+    {
+      return is_space(static_cast<unsigned char>(*_ptr)) ? ' ' : *_ptr;
+    }
+
+    Chars& operator++()
+    {
+      if (is_space(static_cast<unsigned char>(*_ptr++)))
+      {
+        while (_ptr < _end && is_space(static_cast<unsigned char>(*_ptr)))
+        {
+          ++_ptr;
+        }
+      }
+
+      return *this;
+    }
+
+    Chars operator++(int)
+    {
+      auto res = *this;
+      ++*this;
+
+      return res;
+    }
+
+    Chars& operator--()
+    {
+      if (is_space(static_cast<unsigned char>(*--_ptr)))
+      {
+        while (_ptr > _begin && is_space(static_cast<unsigned char>(_ptr[-1])))
+        {
+          --_ptr;
+        }
+      }
+
+      return *this;
+    }
+
+    Chars operator--(int)
+    {
+      auto res = *this;
+      --*this;
+
+      return res;
+    }
+
+    bool operator==(Chars const& other) const
+    {
+      return _ptr == other._ptr;
+    }
+
+    bool operator!=(Chars const& other) const
+    {
+      return _ptr != other._ptr;
+    }
+
+    char const* base() const
+    {
+      return _ptr;
+    }
+
+  private:
+
+    char const* _ptr {nullptr};
+    char const* _begin {nullptr};
+    char const* _end {nullptr};
+  };
+
+  struct Ctx
+  {
+    std::regex rgx;
+  } _ctx;
+};
+
+// add the lowercase char of a set matching a single char other than whitespace,
+// or both cases of a letter
+bool single(Node const& node, std::string& str)
+{
+  if (node.type != Node::Type::set)
+  {
+    return false;
+  }
+
+  auto const count = node.set.count();
+
+  for (std::size_t c = 0; c < 256; ++c)
+  {
+    if (node.set[c])
+    {
+      if ((count == 1 && ! is_space(static_cast<unsigned char>(c))) ||
+        (count == 2 && c >= 'A' && c <= 'Z' && node.set[c + 32]))
+      {
+        str += static_cast<char>(lower(static_cast<unsigned char>(c)));
+
+        return true;
+      }
+
+      return false;
+    }
+  }
+
+  return false;
+}
+
+// lowercase string of a pattern made of single chars only, empty otherwise
+std::string literal(Node const& root)
+{
+  std::string str;
+
+  if (root.type == Node::Type::cat)
+  {
+    for (auto const& node : root.nodes)
+    {
+      if (! single(node, str))
+      {
+        return {};
+      }
+    }
+  }
+  else if (! single(root, str))
+  {
+    return {};
+  }
+
+  return str;
+}
+
+// lowercase words of a pattern made of single chars and a single space between each two,
+// a space being a set of whitespace with a space in it, or one or more of them,
+// as a run of whitespace reads as one space, empty otherwise
+std::vector<std::string> phrase(Node const& root)
+{
+  auto const space = [](Node const& node) {
+    auto const& set = node.type == Node::Type::repeat && node.min == 1 && node.max == npos ?
+      node.nodes.front() : node;
+
+    if (set.type != Node::Type::set || ! set.set[' '])
+    {
+      return false;
+    }
+
+    for (std::size_t c = 0; c < 256; ++c)
+    {
+      if (set.set[c] && ! is_space(static_cast<unsigned char>(c)))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  if (root.type != Node::Type::cat)
+  {
+    return {};
+  }
+
+  std::vector<std::string> words(1);
+
+  for (auto const& node : root.nodes)
+  {
+    if (space(node))
+    {
+      words.emplace_back();
+    }
+    else if (! single(node, words.back()))
+    {
+      return {};
+    }
+  }
+
+  for (auto const& word : words)
+  {
+    if (word.empty())
+    {
+      return {};
+    }
+  }
+
+  return words;
+}
+
+} // namespace
+
+bool Pattern::compile(std::string const& rx)
+{
+  _ctx.engine.reset();
+  _ctx.literal.clear();
+
+  Node root;
+  auto const done = [&] {
+    _ctx.engine->stop = _ctx.stop;
+
+    return true;
+  };
+
+  if (Parser(rx).parse(root))
+  {
+    if (auto str = ::literal(root); ! str.empty())
+    {
+      _ctx.literal = str;
+      _ctx.engine = std::make_unique<Literal>(std::move(str));
+
+      return done();
+    }
+
+    if (auto words = ::phrase(root); ! words.empty())
+    {
+      _ctx.engine = std::make_unique<Literal>(std::move(words));
+
+      return done();
+    }
+
+    Program forward;
+    Program reverse;
+
+    if (::compile(root, false, true, forward) && ::compile(root, true, false, reverse))
+    {
+      _ctx.engine = std::make_unique<Automaton>(std::move(forward), std::move(reverse));
+
+      return done();
+    }
+  }
+
+  try
+  {
+    _ctx.engine = std::make_unique<Backtrack>(rx);
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  return done();
+}
+
+bool Pattern::compile(std::vector<std::string> const& strs)
+{
+  _ctx.engine.reset();
+  _ctx.literal.clear();
+
+  if (std::none_of(strs.begin(), strs.end(), [](auto const& e) { return ! e.empty(); }))
+  {
+    return false;
+  }
+
+  try
+  {
+    _ctx.engine = std::make_unique<Strings>(strs);
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  _ctx.engine->stop = _ctx.stop;
+
+  return true;
+}
+
+bool Pattern::compile(std::string const& str, std::size_t const dist, std::size_t const width)
+{
+  _ctx.engine.reset();
+  _ctx.literal.clear();
+
+  if (str.empty() || (dist && str.size() > Fuzzy::size_max) || dist >= str.size() ||
+    std::any_of(str.begin(), str.end(), [](char const c) { return is_space(static_cast<unsigned char>(c)); }))
+  {
+    return false;
+  }
+
+  std::string lowered;
+  lowered.reserve(str.size());
+
+  for (auto const c : str)
+  {
+    lowered += static_cast<char>(lower(static_cast<unsigned char>(c)));
+  }
+
+  _ctx.engine = std::make_unique<Fuzzy>(std::move(lowered), dist, width);
+  _ctx.engine->stop = _ctx.stop;
+
+  return true;
+}
+
+Pattern::Pattern(Pattern const& other) :
+  _ctx {other._ctx.engine ? other._ctx.engine->clone() : nullptr, other._ctx.stop, other._ctx.literal}
+{
+}
+
+Pattern& Pattern::operator=(Pattern const& other)
+{
+  if (this != &other)
+  {
+    _ctx.engine = other._ctx.engine ? other._ctx.engine->clone() : nullptr;
+    _ctx.stop = other._ctx.stop;
+    _ctx.literal = other._ctx.literal;
+  }
+
+  return *this;
+}
+
+void Pattern::set_stop(std::atomic<bool> const* stop)
+{
+  _ctx.stop = stop;
+
+  if (_ctx.engine)
+  {
+    _ctx.engine->stop = stop;
+  }
+}
+
+void Pattern::clear()
+{
+  _ctx.engine.reset();
+  _ctx.literal.clear();
+}
+
+bool Pattern::find(std::string_view const str, std::size_t const pos, Match& match)
+{
+  return find(str, pos, npos, match);
+}
+
+bool Pattern::find(std::string_view const str, std::size_t const pos, std::size_t const limit, Match& match)
+{
+  if (! _ctx.engine || pos > str.size() || pos >= limit)
+  {
+    return false;
+  }
+
+  return _ctx.engine->find(str, pos, limit, match) && match.begin < limit;
+}
+
+std::string_view Pattern::engine() const
+{
+  return _ctx.engine ? _ctx.engine->name() : std::string_view {};
+}
+
+std::string const& Pattern::literal() const
+{
+  return _ctx.literal;
+}
+
+std::string Pattern::escape(std::string_view const str)
+{
+  std::string res;
+  res.reserve(str.size());
+
+  for (auto const c : str)
+  {
+    if (std::string_view("^$\\.*+?()[]{}|").find(c) != npos)
+    {
+      res += '\\';
+    }
+
+    res += c;
+  }
+
+  return res;
+}
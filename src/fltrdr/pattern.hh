@@ -0,0 +1,107 @@
+#ifndef PATTERN_HH
+#define PATTERN_HH
+
+#include <cstddef>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// case-insensitive ECMAScript pattern,
+// searched in text read as if its words were separated by single spaces,
+// each run of whitespace reading as one space,
+// regular patterns are matched in linear time by an automaton,
+// patterns beyond them, such as backreferences, fall back to std::regex,
+// plain text can also be matched approximately against whole words
+class Pattern
+{
+public:
+
+  // offsets of a match
+  struct Match
+  {
+    std::size_t begin {0};
+    std::size_t end {0};
+  };
+
+  // search backend for a compiled pattern
+  class Engine
+  {
+  public:
+
+    virtual ~Engine() = default;
+
+    // find the first non-empty match in str from offset pos,
+    // the chars before pos are seen by anchors and word boundaries,
+    // a match starting at or past limit may be missed, which lets the search end early
+    virtual bool find(std::string_view const str, std::size_t const pos, std::size_t const limit, Match& match) = 0;
+
+    // copy of the engine with its own search state
+    virtual std::unique_ptr<Engine> clone() const = 0;
+
+    virtual std::string_view name() const = 0;
+
+    // looked at while searching, a search stopped by it finds nothing
+    std::atomic<bool> const* stop {nullptr};
+  };
+
+  Pattern() = default;
+
+  // a copy can search at the same time as the original
+  Pattern(Pattern const& other);
+  Pattern& operator=(Pattern const& other);
+  ~Pattern() = default;
+
+  // compile the pattern, choosing the fastest engine able to run it,
+  // returns false if the pattern is invalid
+  bool compile(std::string const& rx);
+
+  // compile a set of plain text strings, matched case-insensitively,
+  // with whitespace in them matching a run of whitespace,
+  // where a match is the string ending first, returns false if all are empty
+  bool compile(std::vector<std::string> const& strs);
+
+  // compile a plain text string matched case-insensitively against whole words,
+  // less their leading and trailing punctuation, that are within dist edits of it,
+  // inserting, deleting, or replacing a char, a match being the whole word,
+  // words longer than width, when not 0, are matched as parts of width chars each,
+  // like the words of a text of that width,
+  // returns false if the string is empty or has whitespace, dist is not below its size,
+  // or dist is not 0 and the string is longer than 64 chars
+  bool compile(std::string const& str, std::size_t const dist, std::size_t const width = 0);
+
+  void clear();
+
+  // flag that stops a search in progress when set, checked every so often
+  void set_stop(std::atomic<bool> const* stop);
+
+  // find the first non-empty match in str from offset pos
+  bool find(std::string_view const str, std::size_t const pos, Match& match);
+
+  // find the first non-empty match in str from offset pos starting before limit,
+  // the search ends early where no match can start before limit
+  // for every engine but the std::regex one
+  bool find(std::string_view const str, std::size_t const pos, std::size_t const limit, Match& match);
+
+  // name of the engine in use
+  std::string_view engine() const;
+
+  // lowercase text matched by a pattern without special chars, otherwise empty
+  std::string const& literal() const;
+
+  // pattern matching str as plain text, with its special chars escaped
+  static std::string escape(std::string_view const str);
+
+private:
+
+  struct Ctx
+  {
+    std::unique_ptr<Engine> engine;
+    std::atomic<bool> const* stop {nullptr};
+    std::string literal;
+  } _ctx;
+};
+
+#endif // PATTERN_HH
@@ -464,6 +464,11 @@ std::string Readline::operator()(bool& is_running)
 
     if (num_read == 0)
     {
+      if (_hook && loop && is_running)
+      {
+        _hook(normalize(_input.str));
+      }
+
       std::this_thread::sleep_for(wait);
     }
   }
@@ -482,6 +487,13 @@ std::string Readline::operator()(bool& is_running)
   return res;
 }
 
+Readline& Readline::hook(std::function<void(std::string const&)> const& fn)
+{
+  _hook = fn;
+
+  return *this;
+}
+
 void Readline::add_history(std::string const& str)
 {
   if (! str.empty() && ! (! _history.val.empty() && _history.val.back() == str))
@@ -10,6 +10,7 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 
 #include <string>
 #include <vector>
+#include <functional>
 
 class Readline
 {
@@ -21,6 +22,10 @@ public:
   std::string operator()(bool& is_running);
   void add_history(std::string const& str);
 
+  // called with the input while waiting for more keys,
+  // keys already typed are read before it is called again
+  Readline& hook(std::function<void(std::string const&)> const& fn);
+
 private:
 
   int ctrl_key(int const c) const;
@@ -47,6 +52,8 @@ private:
     std::vector<std::string> val;
     std::size_t idx {0};
   } _history;
+
+  std::function<void(std::string const&)> _hook;
 };
 
 #endif // READLINE_HH
@@ -0,0 +1,330 @@
+#include "fltrdr/screen.hh"
+
+#include "ob/term.hh"
+namespace aec = OB::Term::ANSI_Escape_Codes;
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+
+std::size_t const npos {std::string::npos};
+
+// style of the terminal when it is not known
+Screen::Style const unknown {0xffff};
+
+} // namespace
+
+Screen::Screen()
+{
+  style("");
+}
+
+void Screen::size(std::size_t const width, std::size_t const height)
+{
+  if (width == _ctx.width && height == _ctx.height)
+  {
+    return;
+  }
+
+  _ctx.width = width;
+  _ctx.height = height;
+  _ctx.front.assign(width * height, Cell());
+  _ctx.back.assign(width * height, Cell());
+  _ctx.stale.assign(height, true);
+}
+
+std::size_t Screen::width() const
+{
+  return _ctx.width;
+}
+
+std::size_t Screen::height() const
+{
+  return _ctx.height;
+}
+
+Screen::Style Screen::style(std::string const& codes)
+{
+  if (auto const it = _ctx.ids.find(codes); it != _ctx.ids.end())
+  {
+    return it->second;
+  }
+
+  auto const id = static_cast<Style>(_ctx.styles.size());
+  _ctx.styles.emplace_back(codes);
+  _ctx.ids.emplace(codes, id);
+
+  return id;
+}
+
+void Screen::styles_clear()
+{
+  _ctx.styles.clear();
+  _ctx.ids.clear();
+  style("");
+
+  invalidate();
+}
+
+void Screen::clear()
+{
+  std::fill(_ctx.back.begin(), _ctx.back.end(), Cell());
+}
+
+void Screen::erase(std::size_t const x, std::size_t const y)
+{
+  if (y >= _ctx.height || x >= _ctx.width)
+  {
+    return;
+  }
+
+  auto const row = _ctx.back.begin() + static_cast<std::ptrdiff_t>(y * _ctx.width);
+  std::fill(row + static_cast<std::ptrdiff_t>(x), row + static_cast<std::ptrdiff_t>(_ctx.width), Cell());
+}
+
+std::size_t Screen::put(std::size_t x, std::size_t const y, std::string_view const str, Style const style)
+{
+  if (y >= _ctx.height)
+  {
+    return x;
+  }
+
+  auto* row = _ctx.back.data() + y * _ctx.width;
+
+  for (std::size_t i = 0; i < str.size() && x < _ctx.width; ++x)
+  {
+    auto const c = static_cast<unsigned char>(str[i]);
+
+    // size of the utf-8 char starting with c, 0 if c can not start one
+    std::size_t n {c < 0x80 ? 1u : (c >> 5) == 0x6 ? 2u : (c >> 4) == 0xe ? 3u : (c >> 3) == 0x1e ? 4u : 0u};
+
+    for (std::size_t k = 1; k < n; ++k)
+    {
+      if (i + k >= str.size() || (static_cast<unsigned char>(str[i + k]) >> 6) != 0x2)
+      {
+        n = 0;
+        break;
+      }
+    }
+
+    Cell cell;
+    cell.style = style;
+
+    if (n == 0)
+    {
+      cell.glyph = c;
+      cell.raw = true;
+      ++i;
+    }
+    else if (c < 0x20 || c == 0x7f)
+    {
+      // control chars show as blanks
+      ++i;
+    }
+    else
+    {
+      cell.glyph = 0;
+      cell.size = static_cast<std::uint8_t>(n);
+
+      for (std::size_t k = 0; k < n; ++k)
+      {
+        cell.glyph |= std::uint32_t {static_cast<unsigned char>(str[i + k])} << (8 * k);
+      }
+
+      i += n;
+    }
+
+    row[x] = cell;
+  }
+
+  return x;
+}
+
+std::size_t Screen::fill(std::size_t x, std::size_t const y, std::size_t const count, std::string_view const str,
+  Style const style)
+{
+  if (str.empty())
+  {
+    return x;
+  }
+
+  for (std::size_t i = 0; i < count && x < _ctx.width; ++i)
+  {
+    x = put(x, y, str, style);
+  }
+
+  return x;
+}
+
+void Screen::invalidate()
+{
+  std::fill(_ctx.stale.begin(), _ctx.stale.end(), true);
+}
+
+void Screen::invalidate(std::size_t const y)
+{
+  if (y < _ctx.height)
+  {
+    _ctx.stale[y] = true;
+  }
+}
+
+std::size_t Screen::used(std::vector<Cell> const& grid, std::size_t const y) const
+{
+  auto const* row = grid.data() + y * _ctx.width;
+  auto x = _ctx.width;
+
+  while (x > 0 && row[x - 1] == Cell())
+  {
+    --x;
+  }
+
+  return x;
+}
+
+void Screen::move(std::string& out, std::size_t const x, std::size_t const y)
+{
+  if (x == _ctx.x && y == _ctx.y)
+  {
+    return;
+  }
+
+  out += aec::esc;
+  out += '[';
+  out += std::to_string(y + 1);
+  out += ';';
+  out += std::to_string(x + 1);
+  out += 'H';
+
+  _ctx.x = x;
+  _ctx.y = y;
+}
+
+void Screen::draw(std::string& out, Cell const& cell)
+{
+  if (cell.style != _ctx.pen)
+  {
+    out += aec::clear;
+    out += _ctx.styles[cell.style];
+    _ctx.pen = cell.style;
+  }
+
+  for (std::size_t k = 0; k < cell.size; ++k)
+  {
+    out += static_cast<char>((cell.glyph >> (8 * k)) & 0xff);
+  }
+
+  // a raw byte may be drawn as part of a char with the bytes around it
+  _ctx.x = cell.raw ? npos : _ctx.x + 1;
+}
+
+void Screen::render(std::string& out)
+{
+  auto const begin = out.size();
+  out += aec::cursor_save;
+
+  _ctx.pen = unknown;
+  _ctx.x = npos;
+  _ctx.y = npos;
+
+  auto const erase_end = [&] {
+    if (_ctx.pen != 0)
+    {
+      out += aec::clear;
+      _ctx.pen = 0;
+    }
+
+    out += aec::erase_end;
+  };
+
+  for (std::size_t y = 0; y < _ctx.height; ++y)
+  {
+    auto const* back = _ctx.back.data() + y * _ctx.width;
+    auto const* front = _ctx.front.data() + y * _ctx.width;
+    auto const end = used(_ctx.back, y);
+
+    // raw bytes may not line up with the columns, so their rows are drawn whole
+    auto whole = _ctx.stale[y];
+
+    for (std::size_t x = 0; x < _ctx.width && ! whole; ++x)
+    {
+      whole = back[x].raw || front[x].raw;
+    }
+
+    if (whole)
+    {
+      move(out, 0, y);
+
+      for (std::size_t x = 0; x < end; ++x)
+      {
+        draw(out, back[x]);
+      }
+
+      if (end < _ctx.width)
+      {
+        erase_end();
+      }
+
+      continue;
+    }
+
+    for (std::size_t x = 0; x < _ctx.width;)
+    {
+      if (back[x] == front[x])
+      {
+        ++x;
+        continue;
+      }
+
+      // the rest of the row is blank
+      if (x >= end)
+      {
+        move(out, x, y);
+        erase_end();
+        break;
+      }
+
+      // draw over a few unchanged cells rather than moving past them
+      auto last = x;
+
+      for (auto i = x + 1; i < end && i - last <= _ctx.gap_max; ++i)
+      {
+        if (back[i] != front[i])
+        {
+          last = i;
+        }
+      }
+
+      move(out, x, y);
+
+      for (; x <= last; ++x)
+      {
+        draw(out, back[x]);
+      }
+    }
+  }
+
+  if (out.size() == begin + aec::cursor_save.size())
+  {
+    out.resize(begin);
+  }
+  else
+  {
+    if (_ctx.pen != 0)
+    {
+      out += aec::clear;
+    }
+
+    out += aec::cursor_load;
+  }
+
+  _ctx.front = _ctx.back;
+  std::fill(_ctx.stale.begin(), _ctx.stale.end(), false);
+}
@@ -0,0 +1,122 @@
+#ifndef SCREEN_HH
+#define SCREEN_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+// grid of the cells of the terminal,
+// frames are drawn to a back grid, then rendered as the escape codes
+// that turn the front grid, what the terminal shows, into the back grid
+class Screen
+{
+public:
+
+  // id of an interned style, 0 is the default style
+  using Style = std::uint16_t;
+
+  Screen();
+
+  // resize the grids, forgetting what the terminal shows
+  void size(std::size_t const width, std::size_t const height);
+
+  std::size_t width() const;
+  std::size_t height() const;
+
+  // id of the escape codes of a style
+  Style style(std::string const& codes);
+
+  // forget the styles, so that only those interned from now on are kept,
+  // along with what the terminal shows, as their ids are given out again
+  void styles_clear();
+
+  // blank the back grid
+  void clear();
+
+  // blank row y of the back grid from column x on
+  void erase(std::size_t const x, std::size_t const y);
+
+  // draw the chars of str from column x of row y, cut off at the edge,
+  // returns the column after the last char drawn
+  std::size_t put(std::size_t x, std::size_t const y, std::string_view const str, Style const style);
+
+  // draw str count times from column x of row y, cut off at the edge,
+  // returns the column after the last char drawn
+  std::size_t fill(std::size_t x, std::size_t const y, std::size_t const count, std::string_view const str,
+    Style const style);
+
+  // forget what the terminal shows, so that the next render draws every cell
+  void invalidate();
+
+  // forget what row y of the terminal shows
+  void invalidate(std::size_t const y);
+
+  // append to out the escape codes that draw the cells changed since the last render,
+  // with the cursor left where it was
+  void render(std::string& out);
+
+private:
+
+  // a char of the text and its style,
+  // raw for a byte that is not part of a valid utf-8 char,
+  // which may not take up a column of its own
+  struct Cell
+  {
+    std::uint32_t glyph {' '};
+    std::uint8_t size {1};
+    bool raw {false};
+    Style style {0};
+
+    bool operator==(Cell const& other) const
+    {
+      return glyph == other.glyph && size == other.size && raw == other.raw && style == other.style;
+    }
+
+    bool operator!=(Cell const& other) const
+    {
+      return ! (*this == other);
+    }
+  };
+
+  // column after the last cell of row y of grid that is not blank
+  std::size_t used(std::vector<Cell> const& grid, std::size_t const y) const;
+
+  // append the codes that move the cursor to column x of row y
+  void move(std::string& out, std::size_t const x, std::size_t const y);
+
+  // append a cell, switching to its style first
+  void draw(std::string& out, Cell const& cell);
+
+  struct Ctx
+  {
+    std::size_t width {0};
+    std::size_t height {0};
+
+    // what the terminal shows, and what it is to show next
+    std::vector<Cell> front;
+    std::vector<Cell> back;
+
+    // rows of the front grid that are not known to match the terminal
+    std::vector<bool> stale;
+
+    // escape codes of each style, and the id of each
+    std::vector<std::string> styles;
+    std::unordered_map<std::string, Style> ids;
+
+    // style and cursor position of the terminal while rendering,
+    // the column is npos when not known
+    Style pen {0};
+    std::size_t x {0};
+    std::size_t y {0};
+
+    // max number of unchanged cells between two changed ones
+    // for them to be drawn over rather than moved past
+    std::size_t const gap_max {6};
+  } _ctx;
+};
+
+#endif // SCREEN_HH
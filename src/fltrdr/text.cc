@@ -0,0 +1,1556 @@
+#include "fltrdr/text.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <tuple>
+#include <fstream>
+#include <system_error>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+Text::~Text()
+{
+  unmap();
+
+  _ctx.chunks.clear();
+  if (_ctx.budget.fd != -1)
+  {
+    close(_ctx.budget.fd);
+  }
+}
+
+void Text::Free::operator()(char* ptr) const
+{
+  if (size)
+  {
+    munmap(ptr, size);
+  }
+  else
+  {
+    delete[] ptr;
+  }
+}
+
+void Text::clear()
+{
+  unmap();
+
+  _ctx.chunks.clear();
+  _ctx.chunks.shrink_to_fit();
+  _ctx.reserve = 0;
+
+  // reuse the spill file from the start
+  if (_ctx.budget.fd != -1 && ftruncate(_ctx.budget.fd, 0) == 0)
+  {
+    _ctx.budget.fd_size = 0;
+  }
+  _ctx.budget.begin = 0;
+  _ctx.budget.end = 0;
+  _ctx.budget.touch_begin = 0;
+  _ctx.budget.touch_end = 0;
+
+  _ctx.segments.clear();
+  _ctx.words.clear();
+  _ctx.indexed = 0;
+  _ctx.sentences = {};
+  _ctx.chapters = {};
+}
+
+void Text::set_width(std::size_t const width_max)
+{
+  _ctx.width_max = width_max;
+}
+
+std::size_t Text::width() const
+{
+  return _ctx.width_max;
+}
+
+void Text::reserve(std::size_t const size)
+{
+  _ctx.reserve = size;
+}
+
+void Text::unmap()
+{
+  if (_ctx.map.ptr)
+  {
+    munmap(_ctx.map.ptr, _ctx.map.size);
+    _ctx.map = {};
+  }
+}
+
+bool Text::map(std::string const& path)
+{
+  clear();
+
+  int const fd {open(path.c_str(), O_RDONLY)};
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  // only regular files with content can be mapped
+  struct stat st;
+  if (fstat(fd, &st) == -1 || ! S_ISREG(st.st_mode) || st.st_size <= 0)
+  {
+    close(fd);
+    return false;
+  }
+
+  auto const size = static_cast<std::size_t>(st.st_size);
+  void* ptr {mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  close(fd);
+
+  if (ptr == MAP_FAILED)
+  {
+    return false;
+  }
+
+  _ctx.map.ptr = ptr;
+  _ctx.map.size = size;
+  _ctx.map.dev = static_cast<std::uint64_t>(st.st_dev);
+  _ctx.map.ino = static_cast<std::uint64_t>(st.st_ino);
+  _ctx.map.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+  std::error_code ec;
+  _ctx.map.path = fs::absolute(path, ec).lexically_normal().string();
+
+  _ctx.segments.push_back({0, std::string_view(static_cast<char const*>(ptr), size)});
+
+  return true;
+}
+
+bool Text::load(std::string const& path)
+{
+  if (! _ctx.map.ptr)
+  {
+    return false;
+  }
+
+  std::ifstream file {path, std::ios::binary};
+
+  Header head;
+  if (! file.read(reinterpret_cast<char*>(&head), sizeof(head)))
+  {
+    return false;
+  }
+
+  // the cache file must belong to the same unchanged file
+  if (std::string_view(head.magic, sizeof(head.magic)) != std::string_view(Header().magic, sizeof(head.magic)) ||
+    head.version != Header().version ||
+    head.width != _ctx.width_max ||
+    head.dev != _ctx.map.dev ||
+    head.ino != _ctx.map.ino ||
+    head.size != _ctx.map.size ||
+    head.mtime != _ctx.map.mtime ||
+    head.path != _ctx.map.path.size() ||
+    head.words > head.size ||
+    head.sentences > head.words ||
+    head.data > (head.words + head.sentences) * 10)
+  {
+    return false;
+  }
+
+  std::string buf (head.path + head.data, '\0');
+  if (! file.read(buf.data(), static_cast<std::streamsize>(buf.size())) ||
+    std::string_view(buf).substr(0, head.path) != _ctx.map.path ||
+    head.hash != hash())
+  {
+    return false;
+  }
+
+  // each value is the distance from the previous one,
+  // 7 bits per byte with the high bit set on all but the last byte
+  auto const* ptr = reinterpret_cast<unsigned char const*>(buf.data() + head.path);
+  auto const* end = ptr + head.data;
+
+  auto const get = [&](std::uint64_t& val) {
+    val = 0;
+
+    for (int shift = 0; ptr < end && shift < 64; shift += 7)
+    {
+      auto const c = *ptr++;
+      val |= std::uint64_t {c & 0x7fu} << shift;
+
+      if (! (c & 0x80))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  };
+
+  // the positions must go up and stay within the file,
+  // and the sentence ends within the words
+  Words words;
+  std::vector<std::size_t> sentences;
+  std::uint64_t val {0};
+  std::size_t prev {0};
+
+  for (std::size_t i = 0; i < head.words; ++i)
+  {
+    if (! get(val) || (i && ! val) || val >= _ctx.map.size - prev)
+    {
+      return false;
+    }
+
+    prev += val;
+    words.emplace_back(prev);
+  }
+
+  prev = 0;
+  for (std::size_t i = 0; i < head.sentences; ++i)
+  {
+    if (! get(val) || (i && ! val) || val >= head.words - prev)
+    {
+      return false;
+    }
+
+    prev += val;
+    sentences.emplace_back(prev);
+  }
+
+  if (ptr != end)
+  {
+    return false;
+  }
+
+  words.shrink();
+  _ctx.words = std::move(words);
+  _ctx.indexed = _ctx.map.size;
+  _ctx.map.cached = true;
+
+  _ctx.sentences.words = std::move(sentences);
+  _ctx.sentences.count = _ctx.words.size();
+  _ctx.chapters = {};
+
+  return true;
+}
+
+void Text::save(std::string const& path)
+{
+  if (! _ctx.map.ptr || _ctx.map.cached || _ctx.map.size < _ctx.cache_min)
+  {
+    return;
+  }
+
+  auto const& bounds = sentences();
+
+  // each value is stored as the distance from the previous one
+  std::string data;
+  std::size_t prev {0};
+
+  for (std::size_t i = 0, size = _ctx.words.size(); i < size; ++i)
+  {
+    put(data, _ctx.words[i] - prev);
+    prev = _ctx.words[i];
+  }
+
+  prev = 0;
+  for (auto const e : bounds)
+  {
+    put(data, e - prev);
+    prev = e;
+  }
+
+  Header head;
+  head.dev = _ctx.map.dev;
+  head.ino = _ctx.map.ino;
+  head.size = _ctx.map.size;
+  head.mtime = _ctx.map.mtime;
+  head.hash = hash();
+  head.width = _ctx.width_max;
+  head.words = _ctx.words.size();
+  head.sentences = bounds.size();
+  head.path = _ctx.map.path.size();
+  head.data = data.size();
+
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  // write to a temporary file first so that a partial cache file is never read
+  auto const tmp = path + "." + std::to_string(getpid());
+
+  {
+    std::ofstream file {tmp, std::ios::binary | std::ios::trunc};
+
+    file.write(reinterpret_cast<char const*>(&head), sizeof(head));
+    file.write(_ctx.map.path.data(), static_cast<std::streamsize>(_ctx.map.path.size()));
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    if (file.good())
+    {
+      file.close();
+      fs::rename(tmp, path, ec);
+    }
+  }
+
+  fs::remove(tmp, ec);
+}
+
+void Text::put(std::string& buf, std::uint64_t val)
+{
+  for (; val >= 0x80; val >>= 7)
+  {
+    buf += static_cast<char>((val & 0x7f) | 0x80);
+  }
+
+  buf += static_cast<char>(val);
+}
+
+std::uint64_t Text::id()
+{
+  if (! _ctx.map.ptr || _ctx.map.size < _ctx.cache_min)
+  {
+    return 0;
+  }
+
+  std::uint64_t const val[] {hash(), _ctx.map.size, static_cast<std::uint64_t>(_ctx.map.mtime),
+    _ctx.width_max, size()};
+
+  return hash(std::string_view(reinterpret_cast<char const*>(val), sizeof(val)));
+}
+
+std::uint64_t Text::hash()
+{
+  if (_ctx.map.hashed)
+  {
+    return _ctx.map.hash;
+  }
+
+  // the whole file is hashed, so that an edit anywhere in it
+  // that keeps its size and modification time is still told apart,
+  // a slice at a time on all threads, releasing each slice once hashed
+  auto const str = _ctx.segments.front().str;
+  auto const size = _ctx.slice_min;
+  auto const count = (str.size() + size - 1) / size;
+  auto const threads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)), count);
+
+  std::vector<std::uint64_t> val (count);
+  std::atomic<std::size_t> next {0};
+
+  auto const run = [&] {
+    for (std::size_t n; (n = next++) < count;)
+    {
+      val[n] = hash(str.substr(n * size, size));
+      release(n * size, std::min(str.size(), (n + 1) * size));
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < threads; ++i)
+  {
+    pool.emplace_back(run);
+  }
+  run();
+  for (auto& e : pool)
+  {
+    e.join();
+  }
+
+  _ctx.map.hash = hash(std::string_view(reinterpret_cast<char const*>(val.data()), val.size() * sizeof(std::uint64_t)));
+  _ctx.map.hashed = true;
+
+  return _ctx.map.hash;
+}
+
+std::uint64_t Text::hash(std::string_view const str)
+{
+  // murmur3 style mix over 8 chars at a time
+  auto const rotl = [](std::uint64_t const x, int const r) {
+    return (x << r) | (x >> (64 - r));
+  };
+
+  std::uint64_t res {0x9e3779b97f4a7c15 ^ str.size()};
+  std::size_t i {0};
+
+  for (; i + 8 <= str.size(); i += 8)
+  {
+    std::uint64_t k;
+    std::copy_n(str.data() + i, 8, reinterpret_cast<char*>(&k));
+
+    k *= 0x87c37b91114253d5;
+    k = rotl(k, 31);
+    k *= 0x4cf5ad432745937f;
+    res ^= k;
+    res = rotl(res, 27) * 5 + 0x52dce729;
+  }
+
+  for (; i < str.size(); ++i)
+  {
+    res ^= static_cast<unsigned char>(str[i]);
+    res *= 0x100000001b3;
+  }
+
+  res ^= res >> 33;
+  res *= 0xff51afd7ed558ccd;
+  res ^= res >> 33;
+
+  return res;
+}
+
+void Text::read(std::istream& input)
+{
+  auto const begin = end();
+
+  // read straight into the free space of the last chunk
+  while (input)
+  {
+    grow();
+
+    auto& chunk = _ctx.chunks.back();
+    input.read(chunk.ptr.get() + chunk.size, static_cast<std::streamsize>(chunk.capacity - chunk.size));
+    chunk.size += static_cast<std::size_t>(input.gcount());
+    _ctx.segments.back().str = std::string_view(chunk.ptr.get(), chunk.size);
+
+    // avoid starting a new chunk if the input has ended
+    if (input.peek() == std::char_traits<char>::eof())
+    {
+      break;
+    }
+  }
+
+  touch(begin, end());
+}
+
+void Text::assign(std::string_view const str)
+{
+  clear();
+  store(str);
+}
+
+void Text::store(std::string_view str)
+{
+  auto const begin = end();
+
+  while (! str.empty())
+  {
+    grow();
+
+    auto& chunk = _ctx.chunks.back();
+    auto const size = std::min(str.size(), chunk.capacity - chunk.size);
+    std::copy_n(str.data(), size, chunk.ptr.get() + chunk.size);
+    chunk.size += size;
+    _ctx.segments.back().str = std::string_view(chunk.ptr.get(), chunk.size);
+
+    str.remove_prefix(size);
+  }
+
+  touch(begin, end());
+}
+
+void Text::grow()
+{
+  if (! _ctx.chunks.empty() && _ctx.chunks.back().size < _ctx.chunks.back().capacity)
+  {
+    return;
+  }
+
+  Ctx::Chunk chunk;
+  chunk.capacity = std::max(_ctx.reserve, _ctx.chunk_min);
+
+  Segment seg;
+
+  if (! _ctx.chunks.empty())
+  {
+    auto& prev = _ctx.chunks.back();
+    auto& prev_seg = _ctx.segments.back();
+
+    chunk.capacity = prev.capacity * 2;
+
+    // find the start of the trailing partial word, aligned to the max width
+    // so that the words split from a long word stay the same
+    auto begin = prev.size;
+    while (begin && ! is_space(prev.ptr[begin - 1]))
+    {
+      --begin;
+    }
+    begin += (prev.size - begin) / _ctx.width_max * _ctx.width_max;
+
+    // move the partial word into the new chunk
+    chunk.ptr = alloc(chunk.capacity);
+    chunk.size = prev.size - begin;
+    std::copy_n(prev.ptr.get() + begin, chunk.size, chunk.ptr.get());
+
+    prev.size = begin;
+    prev_seg.str = std::string_view(prev.ptr.get(), prev.size);
+
+    seg.pos = prev_seg.pos + prev.size;
+  }
+  else
+  {
+    chunk.ptr = alloc(chunk.capacity);
+  }
+
+  seg.str = std::string_view(chunk.ptr.get(), chunk.size);
+
+  _ctx.chunks.emplace_back(std::move(chunk));
+  _ctx.segments.emplace_back(seg);
+}
+
+void Text::index()
+{
+  _ctx.words.clear();
+  _ctx.indexed = 0;
+  _ctx.sentences = {};
+  _ctx.chapters = {};
+
+  if (_ctx.map.ptr)
+  {
+    madvise(_ctx.map.ptr, _ctx.map.size, MADV_SEQUENTIAL);
+  }
+
+  for (auto const& seg : _ctx.segments)
+  {
+    if (! _ctx.budget.size)
+    {
+      index(seg);
+    }
+    else
+    {
+      // index the segment in blocks of half the budget split on whitespace,
+      // releasing each block once it has been indexed
+      for (std::size_t begin = 0; begin < seg.str.size();)
+      {
+        auto end = std::min(begin + _ctx.budget.size / 2, seg.str.size());
+        while (end < seg.str.size() && ! is_space(seg.str[end]))
+        {
+          ++end;
+        }
+
+        index(Segment {seg.pos + begin, seg.str.substr(begin, end - begin)});
+        release(seg.pos + begin, seg.pos + end);
+
+        begin = end;
+      }
+    }
+
+    _ctx.indexed = seg.pos + seg.str.size();
+  }
+
+  _ctx.words.shrink();
+
+  if (_ctx.map.ptr)
+  {
+    madvise(_ctx.map.ptr, _ctx.map.size, MADV_RANDOM);
+  }
+}
+
+void Text::index(Segment const& seg)
+{
+  auto const size = seg.str.size();
+  auto const threads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)),
+    std::max(size / _ctx.slice_min, std::size_t {1}));
+
+  if (threads == 1)
+  {
+    tokenize(seg.str, seg.pos, 0, _ctx.width_max, true, _ctx.words);
+    return;
+  }
+
+  // split the segment into one slice per thread,
+  // moving each split point forward onto whitespace so that no word is cut
+  std::vector<std::size_t> bounds {0};
+  for (std::size_t i = 1; i < threads; ++i)
+  {
+    auto pos = std::max(size * i / threads, bounds.back());
+    while (pos < size && ! is_space(seg.str[pos]))
+    {
+      ++pos;
+    }
+    bounds.emplace_back(pos);
+  }
+  bounds.emplace_back(size);
+
+  // find the words in each slice concurrently
+  std::vector<Words> parts (threads);
+  std::vector<std::thread> pool;
+  for (std::size_t i = 0; i < threads; ++i)
+  {
+    pool.emplace_back([&, i] {
+      tokenize(seg.str.substr(0, bounds[i + 1]), seg.pos, bounds[i],
+        _ctx.width_max, true, parts[i]);
+    });
+  }
+  for (auto& e : pool)
+  {
+    e.join();
+  }
+
+  // the parts are moved in order, without copying their words
+  for (auto& e : parts)
+  {
+    _ctx.words.append(std::move(e));
+  }
+}
+
+void Text::append(std::string_view const str)
+{
+  store(str);
+  scan(false);
+}
+
+void Text::finish()
+{
+  scan(true);
+  _ctx.words.shrink();
+}
+
+void Text::scan(bool const eof)
+{
+  for (std::size_t i = 0; i < _ctx.segments.size(); ++i)
+  {
+    auto const& seg = _ctx.segments[i];
+
+    if (_ctx.indexed >= seg.pos + seg.str.size())
+    {
+      continue;
+    }
+
+    // only the last chunk can end with a partial word
+    bool const last {i + 1 == _ctx.segments.size()};
+    auto const begin = _ctx.indexed > seg.pos ? _ctx.indexed - seg.pos : 0;
+
+    _ctx.indexed = seg.pos + tokenize(seg.str, seg.pos, begin, _ctx.width_max,
+      last ? eof : true, _ctx.words);
+  }
+}
+
+std::size_t Text::tokenize(std::string_view const str, std::size_t const base,
+  std::size_t i, std::size_t const width_max, bool const eof,
+  Words& words)
+{
+  auto const size = str.size();
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  bool const avx2 {__builtin_cpu_supports("avx2") != 0};
+#endif
+
+  // text position of the first char of the current word
+  std::size_t begin {i};
+
+  // previous char was part of a word
+  bool word {false};
+
+  auto const add = [&](std::size_t const end)
+  {
+    // split words longer than the max width into multiple words
+    for (auto pos = begin; pos < end; pos += width_max)
+    {
+      words.emplace_back(base + pos);
+    }
+  };
+
+  // classify the text in blocks of 64 chars,
+  // then walk the word boundaries found in each block
+  while (i < size)
+  {
+    auto const len = std::min(size - i, std::size_t {64});
+    auto const valid = len == 64 ? ~std::uint64_t {0} : (std::uint64_t {1} << len) - 1;
+
+    std::uint64_t space {0};
+    if (len == 64)
+    {
+#if defined(__GNUC__) && defined(__x86_64__)
+      space = avx2 ? space_mask_avx2(str.data() + i) : space_mask_sse2(str.data() + i);
+#elif defined(__SSE2__)
+      space = space_mask_sse2(str.data() + i);
+#else
+      space = space_mask(str.data() + i, len);
+#endif
+    }
+    else
+    {
+      space = space_mask(str.data() + i, len);
+    }
+
+    auto const text = ~space & valid;
+    auto const first = text & ((space << 1) | (word ? 0 : 1));
+    auto const last = space & valid & ((text << 1) | (word ? 1 : 0));
+
+    for (auto bits = first | last; bits; bits &= bits - 1)
+    {
+      auto const n = static_cast<std::size_t>(__builtin_ctzll(bits));
+
+      if ((first >> n) & 1)
+      {
+        begin = i + n;
+      }
+      else
+      {
+        add(i + n);
+      }
+    }
+
+    word = (text >> (len - 1)) & 1;
+    i += len;
+  }
+
+  if (word)
+  {
+    // the word may continue in text that has not been appended yet,
+    // only add the parts of it that are already at the max width
+    if (! eof)
+    {
+      auto const end = begin + (size - begin) / width_max * width_max;
+      add(end);
+
+      return end;
+    }
+
+    add(size);
+  }
+
+  return size;
+}
+
+std::uint64_t Text::space_mask(char const* ptr, std::size_t const size)
+{
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    if (is_space(ptr[i]))
+    {
+      mask |= std::uint64_t {1} << i;
+    }
+  }
+
+  return mask;
+}
+
+#if defined(__SSE2__)
+std::uint64_t Text::space_mask_sse2(char const* ptr)
+{
+  // a char is whitespace if it is a space or in the range '\t' to '\r'
+  auto const space = _mm_set1_epi8(' ');
+  auto const tab = _mm_set1_epi8('\t');
+  auto const range = _mm_set1_epi8('\r' - '\t');
+
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    auto const val = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr + i * 16));
+    auto const off = _mm_sub_epi8(val, tab);
+    auto const res = _mm_or_si128(_mm_cmpeq_epi8(val, space),
+      _mm_cmpeq_epi8(_mm_min_epu8(off, range), off));
+
+    mask |= std::uint64_t {static_cast<std::uint16_t>(_mm_movemask_epi8(res))} << (i * 16);
+  }
+
+  return mask;
+}
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+__attribute__((target("avx2")))
+std::uint64_t Text::space_mask_avx2(char const* ptr)
+{
+  // a char is whitespace if it is a space or in the range '\t' to '\r'
+  auto const space = _mm256_set1_epi8(' ');
+  auto const tab = _mm256_set1_epi8('\t');
+  auto const range = _mm256_set1_epi8('\r' - '\t');
+
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    auto const val = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr + i * 32));
+    auto const off = _mm256_sub_epi8(val, tab);
+    auto const res = _mm256_or_si256(_mm256_cmpeq_epi8(val, space),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(off, range), off));
+
+    mask |= std::uint64_t {static_cast<std::uint32_t>(_mm256_movemask_epi8(res))} << (i * 32);
+  }
+
+  return mask;
+}
+#endif
+
+std::size_t Text::size() const
+{
+  return _ctx.words.size();
+}
+
+std::size_t Text::pos(std::size_t const i) const
+{
+  return _ctx.words[i];
+}
+
+std::size_t Text::count(std::size_t const pos, std::size_t const first) const
+{
+  auto const& words = _ctx.words;
+  auto const size = Text::size();
+
+  // gallop from first to bound the range, then binary search within it
+  auto begin = first;
+  std::size_t step {1};
+
+  while (begin + step < size && words[begin + step] <= pos)
+  {
+    begin += step;
+    step *= 2;
+  }
+
+  auto end = std::min(begin + step, size);
+
+  while (begin < end)
+  {
+    auto const mid = begin + (end - begin) / 2;
+
+    if (words[mid] <= pos)
+    {
+      begin = mid + 1;
+    }
+    else
+    {
+      end = mid;
+    }
+  }
+
+  return begin;
+}
+
+std::string_view Text::word(std::size_t const i) const
+{
+  auto const pos = Text::pos(i);
+  auto const& seg = segment(pos);
+  auto const begin = pos - seg.pos;
+  auto const max = std::min(begin + _ctx.width_max, seg.str.size());
+
+  auto end = begin;
+  while (end < max && ! is_space(seg.str[end]))
+  {
+    ++end;
+  }
+
+  return seg.str.substr(begin, end - begin);
+}
+
+std::size_t Text::indexed() const
+{
+  return _ctx.indexed;
+}
+
+std::size_t Text::index_size() const
+{
+  return _ctx.words.memory();
+}
+
+std::vector<Text::Segment> const& Text::segments() const
+{
+  return _ctx.segments;
+}
+
+template<typename F>
+void Text::bound(Bounds& bounds, F const& check)
+{
+  auto const size = Text::size();
+
+  while (bounds.count < size)
+  {
+    auto const begin = bounds.count;
+    auto end = size;
+
+    // with a budget, check the words in blocks of half the budget,
+    // releasing each block once it has been checked
+    if (_ctx.budget.size)
+    {
+      auto const limit = pos(begin) + _ctx.budget.size / 2;
+      for (auto lo = begin + 1; lo < end;)
+      {
+        auto const mid = lo + (end - lo) / 2;
+        if (pos(mid) < limit)
+        {
+          lo = mid + 1;
+        }
+        else
+        {
+          end = mid;
+        }
+      }
+    }
+
+    auto const threads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)),
+      std::max((pos(end - 1) - pos(begin)) / _ctx.slice_min, std::size_t {1}));
+
+    if (threads == 1)
+    {
+      check(begin, end, bounds.words);
+    }
+    else
+    {
+      // check one slice of the words per thread, then join the slices in order
+      std::vector<std::vector<std::size_t>> parts (threads);
+      std::vector<std::thread> pool;
+      for (std::size_t i = 0; i < threads; ++i)
+      {
+        pool.emplace_back([&, i] {
+          check(begin + (end - begin) * i / threads,
+            begin + (end - begin) * (i + 1) / threads, parts[i]);
+        });
+      }
+      for (auto& e : pool)
+      {
+        e.join();
+      }
+
+      for (auto const& e : parts)
+      {
+        bounds.words.insert(bounds.words.end(), e.begin(), e.end());
+      }
+    }
+
+    bounds.count = end;
+
+    if (_ctx.budget.size)
+    {
+      release(pos(begin), end < size ? pos(end) : Text::end());
+    }
+  }
+}
+
+template<typename F>
+void Text::match(std::size_t const first, std::size_t const last,
+  F const& find, std::vector<std::size_t>& words) const
+{
+  if (first >= last)
+  {
+    return;
+  }
+
+  // search the text of the words,
+  // mapping each match to the word it starts in
+  auto i = first;
+  auto const begin = pos(first);
+  auto const end = pos(last - 1) + word(last - 1).size();
+
+  for (auto const& seg : _ctx.segments)
+  {
+    if (seg.pos + seg.str.size() <= begin)
+    {
+      continue;
+    }
+
+    if (seg.pos >= end)
+    {
+      break;
+    }
+
+    auto const str = seg.str.substr(0, end - seg.pos);
+
+    for (auto [off, len] = find(str, begin > seg.pos ? begin - seg.pos : 0);
+      off != std::string_view::npos; std::tie(off, len) = find(str, off + 1))
+    {
+      auto const p = seg.pos + off;
+
+      while (i + 1 < last && pos(i + 1) <= p)
+      {
+        ++i;
+      }
+
+      // the match must lie within the word,
+      // a single char match is always a non-space char inside the word
+      if ((len <= 1 || p + len <= pos(i) + word(i).size()) &&
+        (words.empty() || words.back() != i))
+      {
+        words.emplace_back(i);
+      }
+    }
+  }
+}
+
+void Text::set_chapter(std::string const& pattern)
+{
+  auto& chapter = _ctx.chapter;
+
+  chapter.literal = ! pattern.empty() &&
+    pattern.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+  chapter.rgx = chapter.literal ? std::regex() :
+    std::regex(pattern, std::regex::optimize | std::regex::icase);
+  chapter.str = pattern;
+
+  _ctx.chapters = {};
+}
+
+std::vector<std::size_t> const& Text::sentences()
+{
+  auto const find = [](std::string_view const str, std::size_t const i) {
+    return std::make_pair(find_any(str, i, ".!?"), std::size_t {1});
+  };
+
+  bound(_ctx.sentences, [&](std::size_t const first, std::size_t const last,
+    std::vector<std::size_t>& words) {
+    match(first, last, find, words);
+  });
+
+  return _ctx.sentences.words;
+}
+
+std::vector<std::size_t> const& Text::chapters()
+{
+  auto const& chapter = _ctx.chapter;
+
+  if (! chapter.literal)
+  {
+    // match the pattern against each word
+    bound(_ctx.chapters, [&](std::size_t const first, std::size_t const last,
+      std::vector<std::size_t>& words) {
+      for (auto i = first; i < last; ++i)
+      {
+        auto const str = word(i);
+
+        if (std::regex_search(str.begin(), str.end(), chapter.rgx))
+        {
+          words.emplace_back(i);
+        }
+      }
+    });
+
+    return _ctx.chapters.words;
+  }
+
+  auto const lower = [](char const c) {
+    return static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+  };
+  auto const upper = [](char const c) {
+    return static_cast<char>(c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c);
+  };
+
+  std::string needle {chapter.str};
+  std::transform(needle.begin(), needle.end(), needle.begin(), lower);
+
+  // find the first char in either case, then compare the rest
+  std::string const head {needle.front(), upper(needle.front())};
+
+  auto const find = [&](std::string_view const str, std::size_t i) {
+    for (; (i = find_any(str, i, head)) != std::string_view::npos; ++i)
+    {
+      if (str.size() - i >= needle.size() && std::equal(needle.begin() + 1, needle.end(),
+        str.begin() + static_cast<std::ptrdiff_t>(i) + 1,
+        [&](char const lhs, char const rhs) { return lhs == lower(rhs); }))
+      {
+        break;
+      }
+    }
+
+    return std::make_pair(i, needle.size());
+  };
+
+  bound(_ctx.chapters, [&](std::size_t const first, std::size_t const last,
+    std::vector<std::size_t>& words) {
+    match(first, last, find, words);
+  });
+
+  return _ctx.chapters.words;
+}
+
+std::size_t Text::find_any(std::string_view const str, std::size_t i, std::string_view const chars)
+{
+  for (; i < str.size(); i += 64)
+  {
+    if (auto const mask = char_mask(str.data() + i, std::min(str.size() - i, std::size_t {64}), chars))
+    {
+      return i + static_cast<std::size_t>(__builtin_ctzll(mask));
+    }
+  }
+
+  return std::string_view::npos;
+}
+
+std::uint64_t Text::char_mask(char const* ptr, std::size_t const size, std::string_view const chars)
+{
+  std::uint64_t mask {0};
+
+#if defined(__SSE2__)
+  if (size == 64)
+  {
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      auto const val = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr + i * 16));
+
+      auto res = _mm_setzero_si128();
+      for (auto const c : chars)
+      {
+        res = _mm_or_si128(res, _mm_cmpeq_epi8(val, _mm_set1_epi8(c)));
+      }
+
+      mask |= std::uint64_t {static_cast<std::uint16_t>(_mm_movemask_epi8(res))} << (i * 16);
+    }
+
+    return mask;
+  }
+#endif
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    if (chars.find(ptr[i]) != std::string_view::npos)
+    {
+      mask |= std::uint64_t {1} << i;
+    }
+  }
+
+  return mask;
+}
+
+std::uint64_t Text::pair_mask(char const* ptr, std::size_t const dist, char const first, char const last)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+  static bool const avx2 {__builtin_cpu_supports("avx2") != 0};
+
+  return avx2 ? pair_mask_avx2(ptr, dist, first, last) : pair_mask_sse2(ptr, dist, first, last);
+#elif defined(__SSE2__)
+  return pair_mask_sse2(ptr, dist, first, last);
+#else
+  // setting the case bit of a letter makes it lowercase
+  auto const fold = [](char const c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z' ? static_cast<char>(c | 0x20) : c;
+  };
+
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < 64; ++i)
+  {
+    if (fold(ptr[i]) == fold(first) && fold(ptr[i + dist]) == fold(last))
+    {
+      mask |= std::uint64_t {1} << i;
+    }
+  }
+
+  return mask;
+#endif
+}
+
+#if defined(__SSE2__)
+std::uint64_t Text::pair_mask_sse2(char const* ptr, std::size_t const dist, char const first, char const last)
+{
+  // setting the case bit of a letter makes it lowercase,
+  // the bit is only set for chars compared to a letter
+  auto const is_alpha = [](char const c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+  };
+
+  auto const fold_first = _mm_set1_epi8(is_alpha(first) ? 0x20 : 0);
+  auto const fold_last = _mm_set1_epi8(is_alpha(last) ? 0x20 : 0);
+  auto const val_first = _mm_set1_epi8(static_cast<char>(is_alpha(first) ? first | 0x20 : first));
+  auto const val_last = _mm_set1_epi8(static_cast<char>(is_alpha(last) ? last | 0x20 : last));
+
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    auto const lhs = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr + i * 16));
+    auto const rhs = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr + i * 16 + dist));
+    auto const res = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(lhs, fold_first), val_first),
+      _mm_cmpeq_epi8(_mm_or_si128(rhs, fold_last), val_last));
+
+    mask |= std::uint64_t {static_cast<std::uint16_t>(_mm_movemask_epi8(res))} << (i * 16);
+  }
+
+  return mask;
+}
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+__attribute__((target("avx2")))
+std::uint64_t Text::pair_mask_avx2(char const* ptr, std::size_t const dist, char const first, char const last)
+{
+  // setting the case bit of a letter makes it lowercase,
+  // the bit is only set for chars compared to a letter
+  auto const is_alpha = [](char const c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+  };
+
+  auto const fold_first = _mm256_set1_epi8(is_alpha(first) ? 0x20 : 0);
+  auto const fold_last = _mm256_set1_epi8(is_alpha(last) ? 0x20 : 0);
+  auto const val_first = _mm256_set1_epi8(static_cast<char>(is_alpha(first) ? first | 0x20 : first));
+  auto const val_last = _mm256_set1_epi8(static_cast<char>(is_alpha(last) ? last | 0x20 : last));
+
+  std::uint64_t mask {0};
+
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    auto const lhs = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr + i * 32));
+    auto const rhs = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptr + i * 32 + dist));
+    auto const res = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(lhs, fold_first), val_first),
+      _mm256_cmpeq_epi8(_mm256_or_si256(rhs, fold_last), val_last));
+
+    mask |= std::uint64_t {static_cast<std::uint32_t>(_mm256_movemask_epi8(res))} << (i * 32);
+  }
+
+  return mask;
+}
+#endif
+
+void Text::set_budget(std::size_t const size)
+{
+  auto& budget = _ctx.budget;
+
+  budget.size = size ? std::max(size, _ctx.budget_min) : 0;
+
+  // release the text outside the window on the next move of the window
+  budget.begin = 0;
+  budget.end = 0;
+  touch(0, end());
+}
+
+std::size_t Text::budget() const
+{
+  return _ctx.budget.size;
+}
+
+void Text::set_spill(std::string const& dir)
+{
+  _ctx.budget.dir = dir;
+}
+
+void Text::window(std::size_t const pos)
+{
+  auto& budget = _ctx.budget;
+
+  if (! budget.size)
+  {
+    return;
+  }
+
+  // center the window on pos, keeping it in place while pos stays
+  // within a quarter of the window size from its center
+  auto const size = budget.size / 2;
+  auto const begin = pos > size / 2 ? pos - size / 2 : 0;
+  auto const diff = begin > budget.begin ? begin - budget.begin : budget.begin - begin;
+
+  if (budget.end && diff < size / 4 && budget.touch_begin >= budget.touch_end)
+  {
+    return;
+  }
+
+  auto const prev_begin = budget.begin;
+  auto const prev_end = budget.end;
+
+  budget.begin = begin;
+  budget.end = std::min(begin + size, end());
+
+  // release the text that left the window and the text read outside of it
+  release(prev_begin, prev_end);
+  release(budget.touch_begin, budget.touch_end);
+  budget.touch_begin = 0;
+  budget.touch_end = 0;
+
+  // read ahead the text in the window
+  advise(budget.begin, budget.end, MADV_WILLNEED);
+}
+
+void Text::touch(std::size_t const begin, std::size_t const end)
+{
+  auto& budget = _ctx.budget;
+
+  if (! budget.size || begin >= end)
+  {
+    return;
+  }
+
+  if (budget.touch_begin >= budget.touch_end)
+  {
+    budget.touch_begin = begin;
+    budget.touch_end = end;
+  }
+  else
+  {
+    budget.touch_begin = std::min(budget.touch_begin, begin);
+    budget.touch_end = std::max(budget.touch_end, end);
+  }
+}
+
+void Text::release(std::size_t const begin, std::size_t const end) const
+{
+  auto const& budget = _ctx.budget;
+
+  if (! budget.size)
+  {
+    return;
+  }
+
+  // keep the text in the window
+  advise(begin, std::min(end, budget.begin), MADV_DONTNEED);
+  advise(std::max(begin, budget.end), end, MADV_DONTNEED);
+}
+
+void Text::advise(std::size_t const begin, std::size_t const end, int const advice) const
+{
+  if (begin >= end)
+  {
+    return;
+  }
+
+  auto const page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+
+  for (std::size_t i = 0; i < _ctx.segments.size(); ++i)
+  {
+    auto const& seg = _ctx.segments[i];
+
+    // only text backed by a file can be read back in after it is released
+    if (! _ctx.map.ptr && ! _ctx.chunks.at(i).ptr.get_deleter().size)
+    {
+      continue;
+    }
+
+    auto const lo = std::max(begin, seg.pos);
+    auto const hi = std::min(end, seg.pos + seg.str.size());
+
+    if (lo >= hi)
+    {
+      continue;
+    }
+
+    auto first = reinterpret_cast<std::uintptr_t>(seg.str.data() + (lo - seg.pos));
+    auto last = reinterpret_cast<std::uintptr_t>(seg.str.data() + (hi - seg.pos));
+
+    // only release whole pages, the mappings start on a page boundary
+    if (advice == MADV_DONTNEED)
+    {
+      first = (first + page - 1) / page * page;
+      last = last / page * page;
+    }
+    else
+    {
+      first = first / page * page;
+    }
+
+    if (first < last)
+    {
+      madvise(reinterpret_cast<void*>(first), last - first, advice);
+    }
+  }
+}
+
+std::size_t Text::end() const
+{
+  if (_ctx.segments.empty())
+  {
+    return 0;
+  }
+
+  return _ctx.segments.back().pos + _ctx.segments.back().str.size();
+}
+
+std::unique_ptr<char[], Text::Free> Text::alloc(std::size_t const size)
+{
+  auto& budget = _ctx.budget;
+
+  if (budget.size)
+  {
+    if (budget.fd == -1)
+    {
+      // the spill file is removed right away, its space is freed once it is closed
+      std::error_code ec;
+      auto tmp = fs::temp_directory_path(ec);
+      if (ec)
+      {
+        tmp = "/tmp";
+      }
+
+      for (auto const& dir : {fs::path(budget.dir), tmp})
+      {
+        if (dir.empty() || (! fs::create_directories(dir, ec) && ec))
+        {
+          continue;
+        }
+
+        auto path = (dir / "fltrdr.XXXXXX").string();
+        budget.fd = mkstemp(path.data());
+        if (budget.fd != -1)
+        {
+          unlink(path.c_str());
+          break;
+        }
+      }
+    }
+
+    // mappings must start on a page boundary of the file
+    auto const page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto const capacity = (size + page - 1) / page * page;
+
+    if (budget.fd != -1 && ftruncate(budget.fd, static_cast<off_t>(budget.fd_size + capacity)) == 0)
+    {
+      void* ptr {mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+        budget.fd, static_cast<off_t>(budget.fd_size))};
+
+      if (ptr != MAP_FAILED)
+      {
+        budget.fd_size += capacity;
+        return std::unique_ptr<char[], Free>(static_cast<char*>(ptr), Free {capacity});
+      }
+    }
+  }
+
+  return std::unique_ptr<char[], Free>(new char[size], Free {0});
+}
+
+void Text::Words::clear()
+{
+  _ctx = {};
+}
+
+void Text::Words::shrink()
+{
+  for (auto& run : _ctx.runs)
+  {
+    run.base.shrink_to_fit();
+    run.off.shrink_to_fit();
+    run.full.shrink_to_fit();
+  }
+
+  _ctx.runs.shrink_to_fit();
+}
+
+std::size_t Text::Words::size() const
+{
+  return _ctx.size;
+}
+
+std::size_t Text::Words::operator[](std::size_t const i) const
+{
+  auto const& runs = _ctx.runs;
+
+  auto const& run = runs.size() == 1 ? runs.front() :
+    *std::prev(std::upper_bound(runs.begin(), runs.end(), i,
+      [](auto const lhs, auto const& rhs) { return lhs < rhs.first; }));
+
+  auto const j = i - run.first;
+  auto const base = run.base[j / block];
+
+  if (base & wide)
+  {
+    return run.full[(base & ~wide) + j % block];
+  }
+
+  return base + run.off[j];
+}
+
+void Text::Words::emplace_back(std::size_t const pos)
+{
+  if (_ctx.runs.empty())
+  {
+    _ctx.runs.emplace_back();
+  }
+
+  auto& run = _ctx.runs.back();
+  auto const j = run.size;
+
+  if (j % block == 0)
+  {
+    run.base.emplace_back(pos);
+  }
+
+  auto& base = run.base.back();
+
+  // a block spanning too much text for its offsets holds full positions instead
+  if (! (base & wide) && pos - base > 0xffff)
+  {
+    auto const offset = run.full.size();
+
+    for (auto k = j / block * block; k < j; ++k)
+    {
+      run.full.emplace_back(base + run.off[k]);
+    }
+
+    base = offset | wide;
+  }
+
+  if (base & wide)
+  {
+    run.full.emplace_back(pos);
+    run.off.emplace_back(0);
+  }
+  else
+  {
+    run.off.emplace_back(static_cast<std::uint16_t>(pos - base));
+  }
+
+  ++run.size;
+  ++_ctx.size;
+}
+
+void Text::Words::append(Words&& other)
+{
+  if (_ctx.size && other._ctx.size < run_min)
+  {
+    for (std::size_t i = 0; i < other._ctx.size; ++i)
+    {
+      emplace_back(other[i]);
+    }
+  }
+  else
+  {
+    for (auto& run : other._ctx.runs)
+    {
+      if (! run.size)
+      {
+        continue;
+      }
+
+      run.first = _ctx.size;
+      _ctx.size += run.size;
+      _ctx.runs.emplace_back(std::move(run));
+    }
+  }
+
+  other.clear();
+}
+
+std::size_t Text::Words::memory() const
+{
+  auto res = _ctx.runs.capacity() * sizeof(Run);
+
+  for (auto const& run : _ctx.runs)
+  {
+    res += run.base.capacity() * sizeof(std::uint64_t) +
+      run.off.capacity() * sizeof(std::uint16_t) +
+      run.full.capacity() * sizeof(std::uint64_t);
+  }
+
+  return res;
+}
+
+Text::Segment const& Text::segment(std::size_t const pos) const
+{
+  if (_ctx.segments.size() == 1)
+  {
+    return _ctx.segments.front();
+  }
+
+  auto const it = std::upper_bound(_ctx.segments.begin(), _ctx.segments.end(), pos,
+    [](auto const lhs, auto const& rhs) { return lhs < rhs.pos; });
+
+  return *std::prev(it);
+}
+
+bool Text::is_space(char const c)
+{
+  // matches the classic locale used by operator>>
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
@@ -0,0 +1,386 @@
+#ifndef TEXT_HH
+#define TEXT_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <regex>
+
+class Text
+{
+public:
+
+  // contiguous run of text starting at text position pos
+  struct Segment
+  {
+    std::size_t pos {0};
+    std::string_view str;
+  };
+
+  Text() = default;
+  Text(Text const&) = delete;
+  Text& operator=(Text const&) = delete;
+  ~Text();
+
+  void clear();
+
+  // maximum word size, longer words are split into multiple words
+  void set_width(std::size_t const width_max);
+  std::size_t width() const;
+
+  // expected size of the owned text, used to size the first chunk
+  void reserve(std::size_t const size);
+
+  // map a file read-only, returns false if the file can not be mapped
+  bool map(std::string const& path);
+
+  // load the word index of the mapped file from a cache file,
+  // returns false if the cache file is missing or out of date
+  bool load(std::string const& path);
+
+  // save the word index of the mapped file to a cache file
+  void save(std::string const& path);
+
+  // key identifying the mapped file and its word index in cache files,
+  // 0 if the text is not large enough to be cached
+  std::uint64_t id();
+
+  // read a stream into the owned text
+  void read(std::istream& input);
+
+  // replace the text with a copy of str
+  void assign(std::string_view const str);
+
+  // build the word index over the text
+  void index();
+
+  // append to the owned text and index the new complete words
+  void append(std::string_view const str);
+
+  // index the remaining words once no more text will be appended
+  void finish();
+
+  // number of words
+  std::size_t size() const;
+
+  // text position of the word at index i
+  std::size_t pos(std::size_t const i) const;
+
+  // word at index i
+  std::string_view word(std::size_t const i) const;
+
+  // number of words starting at or before text position pos,
+  // given that at least the first words do,
+  // found quickly when close to first
+  std::size_t count(std::size_t const pos, std::size_t const first = 0) const;
+
+  // text position up to which words have been indexed
+  std::size_t indexed() const;
+
+  // size in bytes of the word index
+  std::size_t index_size() const;
+
+  // runs of text in text position order
+  std::vector<Segment> const& segments() const;
+
+  // max size of the text kept in memory, 0 for no limit,
+  // text outside a window around the current position is released
+  // from memory and read back in when needed
+  void set_budget(std::size_t const size);
+  std::size_t budget() const;
+
+  // directory of the file that holds the owned text when there is a budget,
+  // the temporary directory when empty or when it can not be created
+  void set_spill(std::string const& dir);
+
+  // move the window of text kept in memory to text position pos,
+  // releasing the text outside of it
+  void window(std::size_t const pos);
+
+  // mark the text in [begin, end) as read,
+  // so that it is released on the next move of the window
+  void touch(std::size_t const begin, std::size_t const end);
+
+  // pattern of the words that start a chapter, matched case-insensitively,
+  // throws std::regex_error if the pattern is invalid
+  void set_chapter(std::string const& pattern);
+
+  // sorted indices of the words that end a sentence
+  std::vector<std::size_t> const& sentences();
+
+  // sorted indices of the words that start a chapter
+  std::vector<std::size_t> const& chapters();
+
+  // offset of the first char in str from offset i that is any of chars
+  static std::size_t find_any(std::string_view const str, std::size_t i, std::string_view const chars);
+
+  // bit mask of the chars in a block of up to 64 chars that are any of chars
+  static std::uint64_t char_mask(char const* ptr, std::size_t const size, std::string_view const chars);
+
+  // bit mask of the offsets i in a block of 64 chars where the char at i is first
+  // and the char at i + dist is last, letters compared case-insensitively,
+  // reads 64 + dist chars
+  static std::uint64_t pair_mask(char const* ptr, std::size_t const dist, char const first, char const last);
+
+private:
+
+  // text positions of the words, in blocks of 64 words holding the position
+  // of their first word and 16-bit offsets from it, or full positions
+  // for the rare blocks spanning 64 KiB or more of text,
+  // words found at once by many threads are kept as runs of blocks of their own
+  class Words
+  {
+  public:
+
+    void clear();
+
+    // release the unused capacity
+    void shrink();
+
+    std::size_t size() const;
+
+    // text position of the word at index i
+    std::size_t operator[](std::size_t const i) const;
+
+    // add the word at text position pos, after the last word
+    void emplace_back(std::size_t const pos);
+
+    // move the words of other after the last word
+    void append(Words&& other);
+
+    // size in bytes
+    std::size_t memory() const;
+
+  private:
+
+    static constexpr std::size_t block {64};
+
+    // set in the base of a block holding full positions
+    static constexpr std::uint64_t wide {std::uint64_t {1} << 63};
+
+    // fewer words than this are copied rather than kept as a run
+    static constexpr std::size_t run_min {1 << 16};
+
+    struct Run
+    {
+      // index of the first word, and the number of words
+      std::size_t first {0};
+      std::size_t size {0};
+
+      // text position of the first word of each block,
+      // or the offset of its full positions in full with the wide bit set
+      std::vector<std::uint64_t> base;
+
+      // offset of each word from the first word of its block
+      std::vector<std::uint16_t> off;
+
+      // full positions of the words of the wide blocks
+      std::vector<std::uint64_t> full;
+    };
+
+    struct Ctx
+    {
+      std::vector<Run> runs;
+      std::size_t size {0};
+    } _ctx;
+  };
+
+  void unmap();
+  void scan(bool const eof);
+
+  // hash of the contents of the mapped file
+  std::uint64_t hash();
+
+  // index a whole segment, splitting large segments across threads
+  void index(Segment const& seg);
+
+  // copy str into the owned text
+  void store(std::string_view str);
+
+  // release the memory of the text in [begin, end) outside the window
+  void release(std::size_t const begin, std::size_t const end) const;
+
+  // give the memory advice for the file backed text in [begin, end)
+  void advise(std::size_t const begin, std::size_t const end, int const advice) const;
+
+  // end of the text
+  std::size_t end() const;
+
+  // start a new chunk when the last one is full
+  void grow();
+
+  Segment const& segment(std::size_t const pos) const;
+
+  // find the words in str starting from position i,
+  // adding base to each word position,
+  // returns the position up to which words have been found
+  static std::size_t tokenize(std::string_view const str, std::size_t const base,
+    std::size_t i, std::size_t const width_max, bool const eof,
+    Words& words);
+
+  // bit mask of the whitespace chars in a block of up to 64 chars
+  static std::uint64_t space_mask(char const* ptr, std::size_t const size);
+  static std::uint64_t space_mask_sse2(char const* ptr);
+  static std::uint64_t space_mask_avx2(char const* ptr);
+
+  static std::uint64_t pair_mask_sse2(char const* ptr, std::size_t const dist, char const first, char const last);
+  static std::uint64_t pair_mask_avx2(char const* ptr, std::size_t const dist, char const first, char const last);
+
+  static std::uint64_t hash(std::string_view const str);
+
+  static bool is_space(char const c);
+
+  // sorted indices of the words found so far,
+  // and the number of words that have been checked
+  struct Bounds
+  {
+    std::vector<std::size_t> words;
+    std::size_t count {0};
+  };
+
+  // check the words not yet checked, splitting large ranges across threads,
+  // check(first, last, words) adds the matching words in [first, last) to words
+  template<typename F>
+  void bound(Bounds& bounds, F const& check);
+
+  // add the words in [first, last) that contain a match to words,
+  // find(str, i) returns the offset and size of the next match in str from offset i
+  template<typename F>
+  void match(std::size_t const first, std::size_t const last,
+    F const& find, std::vector<std::size_t>& words) const;
+
+  // frees the memory of a chunk
+  struct Free
+  {
+    // size of the memory mapped from the spill file, 0 for heap memory,
+    // no default member initializer so that it is default constructible within Text
+    std::size_t size;
+
+    void operator()(char* ptr) const;
+  };
+
+  // memory for a chunk, from the spill file when there is a budget
+  std::unique_ptr<char[], Free> alloc(std::size_t const size);
+
+  // cache file header, followed by the file path,
+  // and the word index and the sentence index as varint encoded deltas
+  struct Header
+  {
+    char magic[8] {'f', 'l', 't', 'r', 'd', 'r', 'i', 'x'};
+    std::uint64_t version {5};
+    std::uint64_t dev {0};
+    std::uint64_t ino {0};
+    std::uint64_t size {0};
+    std::int64_t mtime {0};
+    std::uint64_t hash {0};
+    std::uint64_t width {0};
+    std::uint64_t words {0};
+    std::uint64_t sentences {0};
+    std::uint64_t path {0};
+    std::uint64_t data {0};
+  };
+
+  static void put(std::string& buf, std::uint64_t val);
+
+  struct Ctx
+  {
+    // memory mapped file
+    struct Map
+    {
+      void* ptr {nullptr};
+      std::size_t size {0};
+
+      // absolute path, device and inode numbers, and modification time in nanoseconds
+      std::string path;
+      std::uint64_t dev {0};
+      std::uint64_t ino {0};
+      std::int64_t mtime {0};
+
+      // hash of the contents, computed when first needed
+      std::uint64_t hash {0};
+      bool hashed {false};
+
+      // word index loaded from a cache file
+      bool cached {false};
+    } map;
+
+    // min size of a mapped file for its word index to be saved to a cache file
+    std::size_t const cache_min {1 << 20};
+
+    // owned text, stored in chunks that are never reallocated,
+    // a word never spans two chunks
+    struct Chunk
+    {
+      std::unique_ptr<char[], Free> ptr;
+      std::size_t size {0};
+      std::size_t capacity {0};
+    };
+    std::vector<Chunk> chunks;
+
+    // min chunk capacity, each new chunk doubles the previous capacity
+    std::size_t const chunk_min {65536};
+
+    // capacity of the first chunk
+    std::size_t reserve {0};
+
+    // memory use of the text
+    struct Budget
+    {
+      // max size of the text kept in memory, 0 for no limit,
+      // half is used for the window and half for reading the whole text
+      std::size_t size {0};
+
+      // window of text kept in memory
+      std::size_t begin {0};
+      std::size_t end {0};
+
+      // text read outside of the window since the window last moved
+      std::size_t touch_begin {0};
+      std::size_t touch_end {0};
+
+      // unlinked temporary file backing the owned text, its size, and its directory
+      int fd {-1};
+      std::size_t fd_size {0};
+      std::string dir;
+    } budget;
+
+    // min budget, at least two hash blocks
+    std::size_t const budget_min {std::size_t {1} << 27};
+
+    // runs of text, one for the mapped file or one per chunk
+    std::vector<Segment> segments;
+
+    // maximum word size
+    std::size_t width_max {20};
+
+    // min size of the slice of text indexed by each thread
+    std::size_t const slice_min {1 << 22};
+
+    // text position of the first char of each word
+    Words words;
+
+    // text position up to which words have been indexed
+    std::size_t indexed {0};
+
+    // words containing any of the chars '.!?'
+    Bounds sentences;
+
+    // words matching the chapter pattern
+    Bounds chapters;
+
+    // chapter pattern, searched for directly when it has no special chars
+    struct Chapter
+    {
+      std::string str {"chapter"};
+      std::regex rgx;
+      bool literal {true};
+    } chapter;
+  } _ctx;
+};
+
+#endif // TEXT_HH
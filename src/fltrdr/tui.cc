@@ -5,7 +5,10 @@
 #include "ob/term.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
+#include <unistd.h>
+
 #include <ctime>
+#include <cerrno>
 #include <cmath>
 #include <cctype>
 #include <cstdio>
@@ -17,6 +20,7 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <array>
 #include <chrono>
 #include <thread>
 #include <algorithm>
@@ -30,6 +34,8 @@ namespace fs = std::filesystem;
 Tui::Tui() :
   _colorterm {OB::Term::is_colorterm()}
 {
+  // enough for most frames to be drawn without growing the buffer
+  _ctx.out.reserve(1 << 16);
 }
 
 Tui& Tui::init(std::string const& file_path)
@@ -49,7 +55,9 @@ Tui& Tui::init(std::string const& file_path)
   // parse from stdin
   else if (file_path == "*stdin*")
   {
-    if (_fltrdr.parse(std::cin))
+    // read in the background from a duplicate of stdin,
+    // leaving stdin free to be reopened on the terminal
+    if (_fltrdr.stream(dup(STDIN_FILENO)))
     {
       _ctx.file.path = "*stdin*";
       _ctx.file.name = "*stdin*";
@@ -64,13 +72,7 @@ Tui& Tui::init(std::string const& file_path)
       throw std::runtime_error("the file does not exist '" + _ctx.file.path + "'");
     }
 
-    std::ifstream ifile {file_path};
-    if (! ifile.is_open())
-    {
-      throw std::runtime_error("could not open the file '" + file_path + "'");
-    }
-
-    if (_fltrdr.parse(ifile))
+    if (_fltrdr.open(file_path))
     {
       _ctx.file.path = file_path;
       _ctx.file.name = fs::path(file_path).lexically_normal().string();
@@ -80,6 +82,21 @@ Tui& Tui::init(std::string const& file_path)
   return *this;
 }
 
+Tui& Tui::budget(std::size_t const size)
+{
+  // size in MiB
+  _fltrdr.set_budget(size * 1024 * 1024);
+
+  return *this;
+}
+
+Tui& Tui::word_index(bool const val)
+{
+  _fltrdr.set_word_index(val);
+
+  return *this;
+}
+
 bool Tui::press_to_continue(std::string const& str, int val)
 {
   std::cerr
@@ -224,10 +241,17 @@ void Tui::run()
   << aec::cursor_home
   << std::flush;
 
+  // intern the styles set by the config file
+  intern_styles();
+
   // set terminal mode to raw
   _term_mode.set_min(0);
   _term_mode.set_raw();
 
+  // wrap frames in synchronized output if the terminal supports it
+  int state {0};
+  _ctx.output.sync = aec::mode_get(2026, state, _ctx.input, false) == 0 && (state == 1 || state == 2);
+
   // start the event loop
   event_loop();
 
@@ -273,6 +297,9 @@ void Tui::event_loop()
     // update screen size
     _fltrdr.screen_size(_ctx.width, _ctx.height);
 
+    // add text read in the background
+    _fltrdr.update();
+
     // update offset
     _ctx.offset = static_cast<std::size_t>(_ctx.offset_value / 10.0 * static_cast<double>(_ctx.width / 2));
 
@@ -290,6 +317,12 @@ void Tui::event_loop()
       {
         pause();
       }
+
+      // check for a search match
+      else if (_ctx.state.auto_pause && _fltrdr.search_match())
+      {
+        pause();
+      }
     }
 
     // render new content
@@ -340,24 +373,130 @@ void Tui::event_loop()
 void Tui::clear()
 {
   // clear screen
-  _ctx.buf
-  << aec::cursor_set(0, _ctx.height);
-  OB::Algorithm::for_each(_ctx.height, [&](auto) {
-    _ctx.buf
-    << aec::erase_line
-    << aec::cursor_up;
-  });
+  _screen.size(_ctx.width, _ctx.height);
+  _screen.clear();
 }
 
 void Tui::refresh()
 {
-  // output buffer to screen
-  std::cout
-  << _ctx.buf.str()
-  << std::flush;
+  auto const start = std::chrono::steady_clock::now();
+
+  // output the cells changed since the last frame,
+  // shown at once by terminals that support synchronized output
+  if (_ctx.output.sync)
+  {
+    _ctx.out += aec::sync_begin;
+  }
+
+  _screen.render(_ctx.out);
+
+  if (_ctx.out.size() == (_ctx.output.sync ? aec::sync_begin.size() : 0))
+  {
+    _ctx.out.clear();
+    return;
+  }
+
+  if (_ctx.output.sync)
+  {
+    _ctx.out += aec::sync_end;
+  }
+
+  // write the frame straight to the terminal
+  std::size_t pos {0};
+
+  while (pos < _ctx.out.size())
+  {
+    auto const n = write(STDOUT_FILENO, _ctx.out.data() + pos, _ctx.out.size() - pos);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      break;
+    }
+
+    pos += static_cast<std::size_t>(n);
+  }
+
+  // the screen takes the frame as shown once rendered,
+  // so a frame that did not fully reach the terminal is drawn again in full
+  if (pos < _ctx.out.size())
+  {
+    _screen.invalidate();
+  }
+
+  ++_ctx.output.frames;
+  _ctx.output.bytes += _ctx.out.size();
+  _ctx.output.bytes_last = _ctx.out.size();
+  _ctx.output.bytes_max = std::max(_ctx.output.bytes_max, _ctx.out.size());
+
+  auto const time = std::chrono::steady_clock::now() - start;
+  _ctx.output.time += time;
+  _ctx.output.time_last = time;
+  _ctx.output.time_max = std::max(_ctx.output.time_max, time);
 
   // clear output buffer
-  _ctx.buf.str("");
+  _ctx.out.clear();
+}
+
+std::string Tui::output_stats() const
+{
+  auto const& output = _ctx.output;
+
+  auto const us = [](auto const time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+  };
+
+  std::ostringstream buf;
+
+  buf
+  << output.frames << " frames, "
+  << output.bytes_last << " B last, "
+  << (output.frames ? output.bytes / output.frames : 0) << " B avg, "
+  << output.bytes_max << " B max, "
+  << us(output.time_last) << " us last, "
+  << (output.frames ? us(output.time) / static_cast<long>(output.frames) : 0) << " us avg, "
+  << us(output.time_max) << " us max, "
+  << "sync " << (output.sync ? "on" : "off");
+
+  return buf.str();
+}
+
+void Tui::intern_styles()
+{
+  auto& id = _ctx.style_id;
+  auto& style = _ctx.style;
+
+  // drop the styles interned before, which may no longer be in use
+  _screen.styles_clear();
+
+  id.primary = _screen.style(style.background + style.primary);
+  id.secondary = _screen.style(style.secondary);
+  id.border = _screen.style(style.border);
+  id.progress_bar = _screen.style(style.progress_bar);
+  id.progress_fill = _screen.style(style.progress_fill);
+  id.progress_match = _screen.style(style.progress_match);
+  id.prompt = _screen.style(style.prompt);
+  id.prompt_status = _screen.style(style.prompt_status);
+
+  std::array<std::string const*, word_size> const word {
+    nullptr,
+    &style.word_primary,
+    &style.word_secondary,
+    &style.word_highlight,
+    &style.word_punct,
+    &style.word_quote,
+  };
+
+  for (std::size_t i = 0; i < word_size; ++i)
+  {
+    auto const& codes = word[i] ? *word[i] : std::string();
+    id.word[i] = _screen.style(codes);
+    id.countdown[i] = _screen.style(style.countdown + codes);
+  }
 }
 
 void Tui::draw()
@@ -373,22 +512,11 @@ void Tui::draw()
 
 void Tui::draw_content()
 {
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(0, (_ctx.height / 2) - 1)
-  << aec::erase_line;
-
-  struct Block
-  {
-    std::string before {};
-    std::string value {};
-    std::string after {aec::clear};
-  };
-  using Buf = std::vector<Block>;
-  Buf buf {_ctx.width, Block()};
+  auto const row = (_ctx.height / 2) - 2;
+  _screen.erase(0, row);
 
   // get args for building the line
-  auto const line = _fltrdr.get_line();
+  auto const& line = _fltrdr.get_line();
 
   auto width_left = static_cast<double>((_ctx.width / 2) - _ctx.offset);
   auto width_right = static_cast<double>((_ctx.width / 2) + _ctx.offset) +
@@ -398,142 +526,75 @@ void Tui::draw_content()
   auto perc_right = static_cast<std::size_t>(width_right * (_ctx.state.count_down / static_cast<double>(_ctx.state.count_total)));
 
   auto pad_left = static_cast<std::size_t>(width_left) - perc_left;
-  auto pad_right = static_cast<std::size_t>(width_right) - perc_right;
 
-  // add background style if counting down
+  auto const focus = static_cast<std::size_t>(width_left) - 1;
+
+  // columns with the background style if counting down
+  std::size_t count_begin {0};
+  std::size_t count_end {0};
+
   if (_ctx.state.counting_down)
   {
     if (_ctx.state.count_down)
     {
-      for (auto i = pad_left; i < pad_left + perc_left + perc_right; ++i)
-      {
-        buf.at(i).before += _ctx.style.countdown;
-      }
-    }
-    else
-    {
-      buf.at(width_left - 1).before += _ctx.style.countdown;
-    }
-  }
-
-  // add line prev to buf
-  for (std::size_t i = 0; i < line.prev.size(); ++i)
-  {
-    auto const it = i;
-
-    buf.at(it).value = line.prev.at(i);
-
-    if (line.prev.at(i) == ' ')
-    {
-      continue;
-    }
-
-    if (line.prev.at(i) == '-')
-    {
-      buf.at(it).before += _ctx.style.word_secondary;
-    }
-    else if (line.prev.at(i) == '\'' || line.prev.at(i) == '"')
-    {
-      buf.at(it).before += _ctx.style.word_quote;
-    }
-    else if (std::ispunct(static_cast<unsigned char>(line.prev.at(i))))
-    {
-      buf.at(it).before += _ctx.style.word_punct;
+      count_begin = pad_left;
+      count_end = pad_left + perc_left + perc_right;
     }
     else
     {
-      buf.at(it).before += _ctx.style.word_secondary;
+      count_begin = focus;
+      count_end = focus + 1;
     }
   }
 
-  // add line curr to buf
-  for (std::size_t i = 0; i < line.curr.size(); ++i)
-  {
-    auto const it = i + line.prev.size();
-
-    buf.at(it).value = line.curr.at(i);
+  // draw each char of the line with the style of its kind
+  std::size_t x {0};
 
-    // buf.at(it).before += aec::bold;
-
-    if (i + line.prev.size() == width_left - 1)
-    {
-      buf.at(it).before += _ctx.style.word_highlight;
-    }
-    else if (line.curr.at(i) == '-')
-    {
-      buf.at(it).before += _ctx.style.word_secondary;
-    }
-    else if (line.curr.at(i) == '\'' || line.curr.at(i) == '"')
+  auto const draw_chars = [&](std::string const& str, bool const is_curr) {
+    for (auto const c : str)
     {
-      buf.at(it).before += _ctx.style.word_quote;
-    }
-    else if (std::ispunct(static_cast<unsigned char>(line.curr.at(i))))
-    {
-      buf.at(it).before += _ctx.style.word_punct;
-    }
-    else
-    {
-      buf.at(it).before += _ctx.style.word_primary;
-    }
-  }
+      auto word = is_curr ? word_primary : word_secondary;
 
-  // add line next to buf
-  for (std::size_t i = 0; i < line.next.size(); ++i)
-  {
-    auto const it = i + line.prev.size() + line.curr.size();
-
-    buf.at(it).value = line.next.at(i);
-
-    if (line.next.at(i) == ' ')
-    {
-      continue;
-    }
+      if (is_curr && x == focus)
+      {
+        word = word_highlight;
+      }
+      else if (c == ' ' && ! is_curr)
+      {
+        word = word_plain;
+      }
+      else if (c == '-')
+      {
+        word = word_secondary;
+      }
+      else if (c == '\'' || c == '"')
+      {
+        word = word_quote;
+      }
+      else if (std::ispunct(static_cast<unsigned char>(c)))
+      {
+        word = word_punct;
+      }
 
-    if (line.next.at(i) == '-')
-    {
-      buf.at(it).before += _ctx.style.word_secondary;
+      auto const& style = x >= count_begin && x < count_end ? _ctx.style_id.countdown : _ctx.style_id.word;
+      _screen.put(x, row, std::string_view(&c, 1), style[word]);
+      ++x;
     }
-    else if (line.next.at(i) == '\'' || line.next.at(i) == '"')
-    {
-      buf.at(it).before += _ctx.style.word_quote;
-    }
-    else if (std::ispunct(static_cast<unsigned char>(line.next.at(i))))
-    {
-      buf.at(it).before += _ctx.style.word_punct;
-    }
-    else
-    {
-      buf.at(it).before += _ctx.style.word_secondary;
-    }
-  }
-
-  // render line to buffer
-  for (auto const& e : buf)
-  {
-    _ctx.buf
-    << e.before
-    << e.value
-    << e.after;
-  }
+  };
 
-  _ctx.buf
-  << aec::clear
-  << aec::cursor_load;
+  draw_chars(line.prev, false);
+  draw_chars(line.curr, true);
+  draw_chars(line.next, false);
 }
 
 void Tui::draw_keybuf()
 {
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(_ctx.width - 3, _ctx.height)
-  << aec::erase_end
-  << _ctx.style.secondary
-  << aec::space
-  << _ctx.chars.at(0)
-  << _ctx.chars.at(1)
-  << aec::space
-  << aec::clear
-  << aec::cursor_load;
+  auto const row = _ctx.height - 1;
+  auto const col = _ctx.width - 4;
+  char const keys[] {' ', _ctx.chars.at(0), _ctx.chars.at(1), ' '};
+
+  _screen.erase(col, row);
+  _screen.put(col, row, std::string_view(keys, sizeof(keys)), _ctx.style_id.secondary);
 }
 
 void Tui::draw_progress_bar()
@@ -543,25 +604,45 @@ void Tui::draw_progress_bar()
     return;
   }
 
-  auto height = _ctx.height - 2;
+  auto row = _ctx.height - 3;
   if (! _ctx.show.status)
   {
-    height = _ctx.height - 1;
+    row = _ctx.height - 2;
   }
 
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(0, height)
-  << aec::erase_line
-  // << aec::bold
-  << _ctx.style.progress_bar
-  << OB::String::repeat(_ctx.width, _ctx.sym.progress)
-  << aec::clear
-  << aec::cr
-  << _ctx.style.progress_fill
-  << OB::String::repeat((_fltrdr.progress() * _ctx.width) / 100, _ctx.sym.progress)
-  << aec::clear
-  << aec::cursor_load;
+  _screen.erase(0, row);
+
+  auto const fill = (_fltrdr.progress() * _ctx.width) / 100;
+  auto const& counts = _fltrdr.search_density(_ctx.width);
+  auto const max = counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end());
+
+  if (max == 0)
+  {
+    _screen.fill(0, row, _ctx.width, _ctx.sym.progress, _ctx.style_id.progress_bar);
+    _screen.fill(0, row, fill, _ctx.sym.progress, _ctx.style_id.progress_fill);
+
+    return;
+  }
+
+  // each part of the text holding search matches shows how many it holds
+  // relative to the part holding the most
+  static std::array<char const*, 8> const levels {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+
+  auto const style_bar = _ctx.style_id.progress_bar;
+  auto const style_fill = _ctx.style_id.progress_fill;
+  auto const style_match = _ctx.style_id.progress_match;
+
+  for (std::size_t i = 0; i < counts.size(); ++i)
+  {
+    if (counts[i])
+    {
+      _screen.put(i, row, levels.at((counts[i] * levels.size() - 1) / max), style_match);
+    }
+    else
+    {
+      _screen.put(i, row, _ctx.sym.progress, i < fill ? style_fill : style_bar);
+    }
+  }
 }
 
 void Tui::draw_prompt_message()
@@ -571,12 +652,9 @@ void Tui::draw_prompt_message()
   {
     --_ctx.prompt.count;
 
-    _ctx.buf
-    << aec::cursor_save
-    << aec::cursor_set(0, _ctx.height)
-    << aec::wrap("?", _ctx.style.prompt)
-    << aec::wrap(_ctx.prompt.str.substr(0, _ctx.width - 2), _ctx.style.prompt_status)
-    << aec::cursor_load;
+    auto const row = _ctx.height - 1;
+    auto const col = _screen.put(0, row, "?", _ctx.style_id.prompt);
+    _screen.put(col, row, std::string_view(_ctx.prompt.str).substr(0, _ctx.width - 2), _ctx.style_id.prompt_status);
   }
 }
 
@@ -587,24 +665,26 @@ void Tui::draw_status()
     return;
   }
 
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(0, _ctx.height - 1);
+  auto const row = _ctx.height - 2;
+  auto const style_primary = _ctx.style_id.primary;
+  auto const style_secondary = _ctx.style_id.secondary;
+  std::size_t col {0};
+
+  // draw str with a space on either side
+  auto const put_padded = [&](std::size_t const x, std::string_view const str, Screen::Style const style) {
+    return _screen.put(_screen.put(_screen.put(x, row, " ", style), row, str, style), row, " ", style);
+  };
+
+  _screen.erase(0, row);
 
   // mode
-  _ctx.buf
-  << _ctx.style.background
-  << _ctx.style.primary
-  // << aec::bold
-  << aec::space
-  << _ctx.status.mode
-  << aec::space
-  << aec::clear
-  << aec::space;
+  col = put_padded(col, _ctx.status.mode, style_primary);
+  ++col;
   int const len_mode {2 + static_cast<int>(_ctx.status.mode.size())};
 
   // file
-  int len_file {2 + static_cast<int>(_ctx.file.name.size())};
+  std::string_view const file {_ctx.file.name};
+  int len_file {2 + static_cast<int>(file.size())};
 
   // stats
   std::string stats {_fltrdr.get_stats()};
@@ -616,78 +696,36 @@ void Tui::draw_status()
 
   if (pad_center >= 0)
   {
-    _ctx.buf
-    << _ctx.style.secondary
-    << _ctx.file.name
-    << aec::clear
-    << aec::space;
-
-    while (pad_center--)
-    {
-      _ctx.buf
-      << aec::space;
-    }
-
-    _ctx.buf
-    << _ctx.style.background
-    << _ctx.style.primary
-    << aec::space
-    << stats
-    << aec::space
-    << aec::clear;
+    col = _screen.put(col, row, file, style_secondary);
+    col += 1 + static_cast<std::size_t>(pad_center);
+    put_padded(col, stats, style_primary);
   }
   else
   {
-    if (static_cast<std::size_t>(std::abs(len_center)) < (_ctx.file.name.size()))
-    {
-      _ctx.buf
-      << _ctx.style.secondary
-      << '<'
-      << _ctx.file.name.substr(static_cast<std::size_t>(std::abs(len_center)) + 1)
-      << aec::clear
-      << aec::space
-      << _ctx.style.background
-      << _ctx.style.primary
-      << aec::space
-      << stats
-      << aec::space
-      << aec::clear;
-    }
-    else if (static_cast<std::size_t>(std::abs(len_center)) == (_ctx.file.name.size()))
-    {
-      _ctx.buf
-      << aec::space
-      << _ctx.style.background
-      << _ctx.style.primary
-      << aec::space
-      << stats
-      << aec::space
-      << aec::clear;
-    }
-    else if (static_cast<std::size_t>(std::abs(len_center)) == (_ctx.file.name.size() + 1))
-    {
-      _ctx.buf
-      << _ctx.style.background
-      << _ctx.style.primary
-      << aec::space
-      << stats
-      << aec::space
-      << aec::clear;
+    if (static_cast<std::size_t>(std::abs(len_center)) < (file.size()))
+    {
+      col = _screen.put(col, row, "<", style_secondary);
+      col = _screen.put(col, row, file.substr(static_cast<std::size_t>(std::abs(len_center)) + 1), style_secondary);
+      ++col;
+      put_padded(col, stats, style_primary);
+    }
+    else if (static_cast<std::size_t>(std::abs(len_center)) == (file.size()))
+    {
+      ++col;
+      put_padded(col, stats, style_primary);
+    }
+    else if (static_cast<std::size_t>(std::abs(len_center)) == (file.size() + 1))
+    {
+      put_padded(col, stats, style_primary);
     }
     else
     {
-      _ctx.buf
-      << _ctx.style.background
-      << _ctx.style.primary
-      << aec::space
-      << '<'
-      << stats.substr(static_cast<std::size_t>(std::abs(len_center)) - _ctx.file.name.size())
-      << aec::space
-      << aec::clear;
+      col = _screen.put(col, row, " <", style_primary);
+      col = _screen.put(col, row,
+        std::string_view(stats).substr(static_cast<std::size_t>(std::abs(len_center)) - file.size()), style_primary);
+      _screen.put(col, row, " ", style_primary);
     }
   }
-
-  _ctx.buf << aec::cursor_load;
 }
 
 void Tui::draw_border_top()
@@ -697,19 +735,13 @@ void Tui::draw_border_top()
     return;
   }
 
-  auto const width = (_ctx.width / 2) - _ctx.offset;
-  auto const height = (_ctx.height / 2) - 2;
+  auto const col = (_ctx.width / 2) - _ctx.offset - 1;
+  auto const row = (_ctx.height / 2) - 3;
+  auto const style = _ctx.style_id.border;
 
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(0, height)
-  << aec::erase_line
-  << _ctx.style.border
-  << OB::String::repeat(_ctx.width, _ctx.sym.border_top)
-  << aec::cursor_set(width, height)
-  << _ctx.sym.border_top_mark
-  << aec::clear
-  << aec::cursor_load;
+  _screen.erase(0, row);
+  _screen.fill(0, row, _ctx.width, _ctx.sym.border_top, style);
+  _screen.put(col, row, _ctx.sym.border_top_mark, style);
 }
 
 void Tui::draw_border_bottom()
@@ -719,19 +751,13 @@ void Tui::draw_border_bottom()
     return;
   }
 
-  auto const width = (_ctx.width / 2) - _ctx.offset;
-  auto const height = (_ctx.height / 2);
+  auto const col = (_ctx.width / 2) - _ctx.offset - 1;
+  auto const row = (_ctx.height / 2) - 1;
+  auto const style = _ctx.style_id.border;
 
-  _ctx.buf
-  << aec::cursor_save
-  << aec::cursor_set(0, height)
-  << aec::erase_line
-  << _ctx.style.border
-  << OB::String::repeat(_ctx.width, _ctx.sym.border_bottom)
-  << aec::cursor_set(width, height)
-  << _ctx.sym.border_bottom_mark
-  << aec::clear
-  << aec::cursor_load;
+  _screen.erase(0, row);
+  _screen.fill(0, row, _ctx.width, _ctx.sym.border_bottom, style);
+  _screen.put(col, row, _ctx.sym.border_bottom_mark, style);
 }
 
 void Tui::set_wait()
@@ -753,26 +779,46 @@ void Tui::set_wait()
   }
 }
 
-int Tui::get_key() const
+ssize_t Tui::get_char(char& c)
+{
+  // input read ahead while querying the terminal comes first
+  if (! _ctx.input.empty())
+  {
+    c = _ctx.input.front();
+    _ctx.input.erase(0, 1);
+
+    return 1;
+  }
+
+  return read(STDIN_FILENO, &c, 1);
+}
+
+int Tui::get_key()
 {
   int key {0};
-  int ec = read(STDIN_FILENO, &key, 1);
+  char c {0};
+  auto const ec = get_char(c);
 
   if ((ec == -1) && (errno != EAGAIN))
   {
     throw std::runtime_error("read failed");
   }
 
+  if (ec == 1)
+  {
+    key = static_cast<unsigned char>(c);
+  }
+
   // esc / esc sequence
   if (key == 27)
   {
     char seq[3];
-    if (read(STDIN_FILENO, &seq[0], 1) != 1)
+    if (get_char(seq[0]) != 1)
     {
       return key;
     }
 
-    if (read(STDIN_FILENO, &seq[1], 1) != 1)
+    if (get_char(seq[1]) != 1)
     {
       return key;
     }
@@ -781,7 +827,7 @@ int Tui::get_key() const
     {
       if (seq[1] >= '0' && seq[1] <= '9')
       {
-        if (read(STDIN_FILENO, &seq[2], 1) != 1)
+        if (get_char(seq[2]) != 1)
         {
           return key;
         }
@@ -954,14 +1000,14 @@ void Tui::get_input(int& wait)
     else if (key == '*')
     {
       pause();
-      _fltrdr.search_forward(_fltrdr.word());
+      _fltrdr.search_word(_fltrdr.word(), true);
     }
 
     // search prev current word
     else if (key == '#')
     {
       pause();
-      _fltrdr.search_backward(_fltrdr.word());
+      _fltrdr.search_word(_fltrdr.word(), false);
     }
 
     // search next
@@ -1418,6 +1464,29 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
     _ctx.style.progress_fill = aec::str_to_fg_color(match, bright);
   }
 
+  else if (match_opt = OB::String::match(input,
+    std::regex("^style\\s+progress\\-match\\s+(#?[0-9a-fA-F]{6})$")))
+  {
+    // 24-bit color
+    auto const match = std::move(match_opt.value().at(1));
+    _ctx.style.progress_match = aec::fg_true(match);
+  }
+  else if (match_opt = OB::String::match(input,
+    std::regex("^style\\s+progress\\-match\\s+([0-9]{1,3})$")))
+  {
+    // 8-bit color
+    auto const match = std::move(match_opt.value().at(1));
+    _ctx.style.progress_match = aec::fg_256(match);
+  }
+  else if (match_opt = OB::String::match(input,
+    std::regex("^style\\s+progress\\-match\\s+(black|red|green|yellow|blue|magenta|cyan|white)(:?\\s+(bright))?$")))
+  {
+    // 4-bit color
+    auto const match = std::move(match_opt.value().at(1));
+    auto const bright = ! OB::String::trim(match_opt.value().at(2)).empty();
+    _ctx.style.progress_match = aec::str_to_fg_color(match, bright);
+  }
+
   else if (match_opt = OB::String::match(input,
     std::regex("^style\\s+prompt\\s+(#?[0-9a-fA-F]{6})$")))
   {
@@ -1874,6 +1943,36 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
     }
   }
 
+  else if (match_opt = OB::String::match(input,
+    std::regex("^set\\s+auto\\-pause(:?\\s+(true|false|t|f|1|0|on|off))?$")))
+  {
+    auto const match = OB::String::trim(match_opt.value().at(1));
+
+    if (match.empty() || "true" == match || "t" == match || "1" == match || "on" == match)
+    {
+      _ctx.state.auto_pause = true;
+    }
+    else
+    {
+      _ctx.state.auto_pause = false;
+    }
+  }
+
+  else if (match_opt = OB::String::match(input,
+    std::regex("^set\\s+word\\-index(:?\\s+(true|false|t|f|1|0|on|off))?$")))
+  {
+    auto const match = OB::String::trim(match_opt.value().at(1));
+
+    if (match.empty() || "true" == match || "t" == match || "1" == match || "on" == match)
+    {
+      _fltrdr.set_word_index(true);
+    }
+    else
+    {
+      _fltrdr.set_word_index(false);
+    }
+  }
+
   else if (match_opt = OB::String::match(input,
     std::regex("^set\\s+view(:?\\s+(true|false|t|f|1|0|on|off))?$")))
   {
@@ -1950,16 +2049,17 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
       return std::make_pair(false, "error: could not open file '" + file_path + "'");
     }
 
-    std::ifstream ifile {file_path};
-    if (! ifile.is_open())
+    try
     {
-      return std::make_pair(false, "error: could not open file '" + file_path + "'");
+      if (_fltrdr.open(file_path))
+      {
+        _ctx.file.path = file_path;
+        _ctx.file.name = fs::path(file_path).lexically_normal().string();
+      }
     }
-
-    if (_fltrdr.parse(ifile))
+    catch (...)
     {
-      _ctx.file.path = file_path;
-      _ctx.file.name = fs::path(file_path).lexically_normal().string();
+      return std::make_pair(false, "error: could not open file '" + file_path + "'");
     }
   }
 
@@ -1981,6 +2081,105 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
     _fltrdr.set_index(std::stoul(match));
   }
 
+  // set memory budget
+  else if (match_opt = OB::String::match(input,
+    std::regex("^budget\\s+([0-9]{1,7})$")))
+  {
+    auto const match = std::move(match_opt.value().at(1));
+
+    budget(std::stoul(match));
+  }
+
+  // word index report
+  else if (match_opt = OB::String::match(input,
+    std::regex("^word\\-index$")))
+  {
+    if (! _fltrdr.get_word_index())
+    {
+      return std::make_pair(false, "error: the word index is off");
+    }
+
+    return std::make_pair(true, "word index: " + _fltrdr.word_index_stats());
+  }
+
+  // output report
+  else if (match_opt = OB::String::match(input,
+    std::regex("^output$")))
+  {
+    return std::make_pair(true, "output: " + output_stats());
+  }
+
+  // number of occurrences of a word
+  else if (match_opt = OB::String::match(input,
+    std::regex("^count\\s+([^\\r]+)$")))
+  {
+    auto const match = std::move(match_opt.value().at(1));
+
+    auto const count = _fltrdr.word_count(match);
+
+    if (! count)
+    {
+      return std::make_pair(false, "error: the word index is off");
+    }
+
+    return std::make_pair(true, "'" + match + "' occurs " + std::to_string(count.value()) + " times");
+  }
+
+  // search for a set of strings
+  else if (match_opt = OB::String::match(input,
+    std::regex("^search\\-set\\s+([^\\r]+)$")))
+  {
+    auto const file_path = std::move(match_opt.value().at(1));
+
+    std::ifstream file {file_path};
+
+    if (! file.is_open())
+    {
+      return std::make_pair(false, "error: could not open file '" + file_path + "'");
+    }
+
+    // one string per line
+    std::vector<std::string> strs;
+
+    for (std::string line; std::getline(file, line);)
+    {
+      if (auto str = OB::String::trim(line); ! str.empty())
+      {
+        strs.emplace_back(std::move(str));
+      }
+    }
+
+    if (! _fltrdr.search_set(strs))
+    {
+      return std::make_pair(false, "error: no search strings in file '" + file_path + "'");
+    }
+  }
+
+  // search for words within a number of edits
+  else if (match_opt = OB::String::match(input,
+    std::regex("^fsearch\\s+([^\\r]+?)\\s+([0-9]{1,2})$")))
+  {
+    auto const term = std::move(match_opt.value().at(1));
+    auto const dist = std::stoul(match_opt.value().at(2));
+
+    if (! _fltrdr.search_fuzzy(term, dist))
+    {
+      return std::make_pair(false, "error: fuzzy search needs a single word term of at most 64 chars and fewer edits than its size");
+    }
+  }
+
+  // set chapter pattern
+  else if (match_opt = OB::String::match(input,
+    std::regex("^chapter\\s+([^\\r]+)$")))
+  {
+    auto const match = std::move(match_opt.value().at(1));
+
+    if (! _fltrdr.set_chapter(match))
+    {
+      return std::make_pair(false, "error: invalid chapter pattern '" + match + "'");
+    }
+  }
+
   // set offset
   else if (match_opt = OB::String::match(input,
     std::regex("^offset\\s+([0-8]{1})$")))
@@ -2031,9 +2230,75 @@ void Tui::command_prompt()
     _ctx.prompt.count = _ctx.prompt.timeout;
   }
 
+  // the command may have changed the styles
+  intern_styles();
+
   std::cout
   << aec::cursor_load
   << std::flush;
+
+  // the prompt line was drawn over outside of the screen
+  _screen.invalidate(_ctx.height - 1);
+}
+
+void Tui::search_preview(std::string const& input, bool const forward)
+{
+  if (input != _ctx.search.input)
+  {
+    _ctx.search.input = input;
+    _ctx.search.dirty = true;
+
+    // each search starts from the word the prompt was opened at
+    _fltrdr.set_index(_ctx.search.index);
+
+    if (input.empty())
+    {
+      _fltrdr.search_clear();
+      _ctx.search.valid = true;
+    }
+    else
+    {
+      _ctx.search.valid = forward ? _fltrdr.search_forward(input) : _fltrdr.search_backward(input);
+    }
+  }
+  else if (! _fltrdr.searching())
+  {
+    return;
+  }
+
+  // add the matches found so far, and jump to the first one
+  _fltrdr.update();
+
+  // redraw the word and the status, leaving the prompt line alone
+  _fltrdr.set_line(_ctx.offset);
+  draw_content();
+  draw_progress_bar();
+  draw_status();
+  refresh();
+}
+
+bool Tui::search_submit(std::string const& input, bool const forward)
+{
+  // an empty input cancels the search typed so far
+  if (input.empty())
+  {
+    if (_ctx.search.dirty)
+    {
+      _fltrdr.search_clear();
+      _fltrdr.set_index(_ctx.search.index);
+    }
+
+    return true;
+  }
+
+  if (input != _ctx.search.input)
+  {
+    _ctx.search.input = input;
+    _fltrdr.set_index(_ctx.search.index);
+    _ctx.search.valid = forward ? _fltrdr.search_forward(input) : _fltrdr.search_backward(input);
+  }
+
+  return _ctx.search.valid;
 }
 
 void Tui::search_forward()
@@ -2048,6 +2313,13 @@ void Tui::search_forward()
   // reset prompt message count
   _ctx.prompt.count = 0;
 
+  // search as the input is typed
+  _ctx.search = {};
+  _ctx.search.index = _fltrdr.get_index();
+  _readline_search.hook([&](std::string const& input) {
+    search_preview(input, true);
+  });
+
   // read user input
   _readline_search.prompt("/", std::vector {_ctx.style.prompt});
   auto input {_readline_search(_ctx.is_running)};
@@ -2064,7 +2336,7 @@ void Tui::search_forward()
     return;
   }
 
-  else if (! input.empty() && ! _fltrdr.search_forward(input))
+  else if (! search_submit(input, true))
   {
     _ctx.prompt.str = input;
     std::cout
@@ -2076,6 +2348,9 @@ void Tui::search_forward()
   std::cout
   << aec::cursor_load
   << std::flush;
+
+  // the prompt line was drawn over outside of the screen
+  _screen.invalidate(_ctx.height - 1);
 }
 
 void Tui::search_backward()
@@ -2090,6 +2365,13 @@ void Tui::search_backward()
   // reset prompt message count
   _ctx.prompt.count = 0;
 
+  // search as the input is typed
+  _ctx.search = {};
+  _ctx.search.index = _fltrdr.get_index();
+  _readline_search.hook([&](std::string const& input) {
+    search_preview(input, false);
+  });
+
   // read user input
   _readline_search.prompt("?", std::vector {_ctx.style.prompt});
   auto input {_readline_search(_ctx.is_running)};
@@ -2106,7 +2388,7 @@ void Tui::search_backward()
     return;
   }
 
-  else if (! input.empty() && ! _fltrdr.search_backward(input))
+  else if (! search_submit(input, false))
   {
     _ctx.prompt.str = input;
     std::cout
@@ -2118,6 +2400,9 @@ void Tui::search_backward()
   std::cout
   << aec::cursor_load
   << std::flush;
+
+  // the prompt line was drawn over outside of the screen
+  _screen.invalidate(_ctx.height - 1);
 }
 
 int Tui::ctrl_key(int const c) const
@@ -2134,39 +2419,29 @@ int Tui::screen_size()
   {
     clear();
 
+    std::string msg;
+
     if (width_invalid && height_invalid)
     {
-      _ctx.buf
-      << "Error: width "
-      << _ctx.width
-      << " ("
-      << _ctx.width_min
-      << " min) & height "
-      << _ctx.height
-      << " ("
-      << _ctx.height_min
-      << " min)"
-      << "\n";
+      msg = "Error: width " + std::to_string(_ctx.width) +
+        " (" + std::to_string(_ctx.width_min) + " min) & height " + std::to_string(_ctx.height) +
+        " (" + std::to_string(_ctx.height_min) + " min)";
     }
     else if (width_invalid)
     {
-      _ctx.buf
-      << "Error: width "
-      << _ctx.width
-      << " ("
-      << _ctx.width_min
-      << " min)"
-      << "\n";
+      msg = "Error: width " + std::to_string(_ctx.width) +
+        " (" + std::to_string(_ctx.width_min) + " min)";
     }
     else
     {
-      _ctx.buf
-      << "Error: height "
-      << _ctx.height
-      << " ("
-      << _ctx.height_min
-      << " min)"
-      << "\n";
+      msg = "Error: height " + std::to_string(_ctx.height) +
+        " (" + std::to_string(_ctx.height_min) + " min)";
+    }
+
+    // wrap the message onto the rows below when the screen is too narrow
+    for (std::size_t i = 0, row = 0; i < msg.size() && row < _ctx.height; i += _ctx.width, ++row)
+    {
+      _screen.put(0, row, msg.substr(i, _ctx.width), 0);
     }
 
     refresh();
@@ -3,6 +3,7 @@
 
 #include "fltrdr/readline.hh"
 #include "fltrdr/fltrdr.hh"
+#include "fltrdr/screen.hh"
 
 #include "ob/string.hh"
 #include "ob/term.hh"
@@ -13,6 +14,7 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <cstdlib>
 
 #include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -26,6 +28,8 @@ public:
   Tui();
 
   Tui& init(std::string const& file_path = {});
+  Tui& budget(std::size_t const size);
+  Tui& word_index(bool const val);
   void config(std::string const& custom_path = {});
   void run();
 
@@ -39,7 +43,20 @@ private:
     right,
     del,
   };
-  int get_key() const;
+
+  // styles of the chars of the line
+  enum Word
+  {
+    word_plain,
+    word_primary,
+    word_secondary,
+    word_highlight,
+    word_punct,
+    word_quote,
+    word_size,
+  };
+  ssize_t get_char(char& c);
+  int get_key();
   int ctrl_key(int const c) const;
   void get_input(int& wait);
   bool press_to_continue(std::string const& str = "ANY KEY", int val = 0);
@@ -53,6 +70,12 @@ private:
   void clear();
   void refresh();
 
+  // number of frames written to the terminal and their sizes
+  std::string output_stats() const;
+
+  // intern the styles drawn, after they change
+  void intern_styles();
+
   void draw();
   void draw_content();
   void draw_border_top();
@@ -70,11 +93,19 @@ private:
   void search_forward();
   void search_backward();
 
+  // search for the input typed so far, and show the first match
+  void search_preview(std::string const& input, bool const forward);
+
+  // run the search for the submitted input unless the preview already has,
+  // returns false if the pattern is invalid
+  bool search_submit(std::string const& input, bool const forward);
+
   OB::Term::Mode _term_mode;
   bool const _colorterm;
   Readline _readline;
   Readline _readline_search;
   Fltrdr _fltrdr;
+  Screen _screen;
 
   struct Ctx
   {
@@ -96,7 +127,26 @@ private:
     std::size_t height_min {6};
 
     // output buffer
-    std::ostringstream buf;
+    std::string out;
+
+    // input read ahead of the keys being asked for
+    std::string input;
+
+    // frames written to the terminal, their size in bytes,
+    // and the time taken to render and write them
+    struct Output
+    {
+      std::size_t frames {0};
+      std::size_t bytes {0};
+      std::size_t bytes_last {0};
+      std::size_t bytes_max {0};
+      std::chrono::steady_clock::duration time {0};
+      std::chrono::steady_clock::duration time_last {0};
+      std::chrono::steady_clock::duration time_max {0};
+
+      // the terminal supports synchronized output
+      bool sync {false};
+    } output;
 
     // control when to exit the event loop
     bool is_running {true};
@@ -118,6 +168,9 @@ private:
 
       int wait {250};
       int refresh_rate {250};
+
+      // pause playing on a word holding a search match
+      bool auto_pause {false};
     } state;
 
     // status
@@ -138,6 +191,20 @@ private:
       int timeout {12};
     } prompt;
 
+    // search as you type in the search prompt
+    struct Search
+    {
+      // input last searched for, and if it is a valid pattern
+      std::string input;
+      bool valid {true};
+
+      // a search was run for the input typed so far
+      bool dirty {false};
+
+      // word index when the prompt was opened
+      std::size_t index {0};
+    } search;
+
     struct Show
     {
       bool border_top {true};
@@ -158,6 +225,7 @@ private:
 
       std::string progress_bar {aec::fg_black};
       std::string progress_fill {aec::fg_cyan};
+      std::string progress_match {aec::fg_yellow};
 
       std::string prompt {aec::fg_cyan};
       std::string prompt_status {};
@@ -171,6 +239,23 @@ private:
       std::string word_quote {aec::fg_white};
     } style;
 
+    // ids of the interned styles
+    struct Style_Id
+    {
+      Screen::Style primary {0};
+      Screen::Style secondary {0};
+      Screen::Style border {0};
+      Screen::Style progress_bar {0};
+      Screen::Style progress_fill {0};
+      Screen::Style progress_match {0};
+      Screen::Style prompt {0};
+      Screen::Style prompt_status {0};
+
+      // styles of the chars of the line, and the same on the countdown background
+      std::array<Screen::Style, word_size> word {};
+      std::array<Screen::Style, word_size> countdown {};
+    } style_id;
+
     struct Sym
     {
       std::string border_top {"-"};
@@ -23,7 +23,7 @@ int program_options(Parg& pg)
   pg.name("fltrdr").version("0.1.0 (18.02.2019)");
   pg.description("A TUI text reader for the terminal.");
 
-  pg.usage("[--config=<path>] [<file>]");
+  pg.usage("[--config=<path>] [--budget=<MiB>] [--word-index] [<file>]");
   pg.usage("[--help|-h]");
   pg.usage("[--version|-v]");
   pg.usage("[--license]");
@@ -64,6 +64,13 @@ int program_options(Parg& pg)
     "prev <0-8>\n    set number of prev words to show",
     "next <0-8>\n    set number of next words to show",
     "offset <0-8>\n    set offset of focus point from center",
+    "budget <MiB>\n    set max size of the text kept in memory, 0 for no limit",
+    "chapter <regex>\n    set pattern of words that start a chapter, defaults to 'chapter'",
+    "search-set <path>\n    search for any line of a file as plain text",
+    "fsearch <term> <k>\n    search for words within k edits of term, such as misspellings",
+    "count <word>\n    number of occurrences of a word, needs the word index",
+    "word-index\n    show the size and memory use of the word index",
+    "output\n    show the number of frames drawn, their size and time, and if output is synchronized",
 
     R"RAW(
   reset <value>
@@ -86,6 +93,10 @@ int program_options(Parg& pg)
       toggle border top
     border-bottom
       toggle border bottom
+    auto-pause
+      toggle pausing on search matches while playing
+    word-index
+      toggle the index of the words for instant whole word searches
 )RAW",
 
     R"RAW(sym <value> <char|unicode-char>
@@ -126,6 +137,8 @@ int program_options(Parg& pg)
       set progress bar primary colour to 24-bit, 8-bit, or 4-bit value
     progress-secondary
       set progress bar secondary colour to 24-bit, 8-bit, or 4-bit value
+    progress-match
+      set progress bar search match colour to 24-bit, 8-bit, or 4-bit value
     status-primary
       set status primary colour to 24-bit, 8-bit, or 4-bit value
     status-secondary
@@ -166,10 +179,16 @@ int program_options(Parg& pg)
     "custom path with '--config=<path>'"
   });
 
+  pg.info("Index Cache Locations", {
+    "${XDG_CACHE_HOME}/fltrdr",
+    "${HOME}/.cache/fltrdr",
+  });
+
   pg.info("Examples", {
     "fltrdr",
     "fltrdr <file>",
     "cat <file> | fltrdr",
+    "fltrdr <file.gz|file.xz|file.zst>",
     "fltrdr --config './path/to/config'",
     "fltrdr --help",
     "fltrdr --version",
@@ -195,6 +214,8 @@ int program_options(Parg& pg)
 
   // options
   pg.set("config", "", "path", "custom path to config file");
+  pg.set("budget", "0", "MiB", "max size of the text kept in memory, 0 for no limit");
+  pg.set("word-index", "build an index of the words for instant whole word searches");
 
   pg.set_pos();
 
@@ -275,6 +296,10 @@ int main(int argc, char *argv[])
   {
     Tui tui;
 
+    // limit the text kept in memory before any text is read
+    tui.budget(pg.get<std::size_t>("budget"));
+    tui.word_index(pg.get<bool>("word-index"));
+
     if (! OB::Term::is_term(STDOUT_FILENO))
     {
       throw std::runtime_error("stdout is not a tty");
@@ -446,6 +446,10 @@ std::string const screen_push {esc + "[?1049h"};
 std::string const screen_pop {esc + "[?1049l"};
 std::string const screen_clear {esc + "[2J"};
 
+// synchronized output, the terminal shows what is drawn between begin and end at once
+std::string const sync_begin {esc + "[?2026h"};
+std::string const sync_end {esc + "[?2026l"};
+
 // scroll
 std::string const scroll_up {esc + "M"};
 std::string const scroll_down {esc + "D"};
@@ -856,6 +860,66 @@ inline int cursor_get(std::size_t& x_, std::size_t& y_, bool mode_ = true)
   return 0;
 }
 
+// query the state of a private mode, state_ is set to
+// 0 not recognized, 1 set, 2 reset, 3 permanently set, 4 permanently reset
+// the query is followed by a device attributes query that all terminals answer,
+// so that terminals which ignore the first are not waited on,
+// input read while waiting that is not part of the responses is added to input_
+inline int mode_get(std::size_t mode_, int& state_, std::string& input_, bool mode_raw_ = true)
+{
+  Term::Mode mode;
+
+  if (mode_raw_)
+  {
+    mode.set_raw();
+  }
+
+  std::cout << (esc + "[?" + std::to_string(mode_) + "$p" + esc + "[c") << std::flush;
+
+  std::string buf;
+  char c {0};
+  int res {0};
+
+  // attempt to read the responses for up to 200 milliseconds,
+  // the device attributes response is the last, ending in 'c'
+  for (int retry = 20; buf.size() < 256;)
+  {
+    if (read(STDIN_FILENO, &c, 1) != 1)
+    {
+      if (retry-- == 0)
+      {
+        res = -1;
+        break;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    buf += c;
+
+    if (c == 'c' && buf.rfind(esc + "[?") != std::string::npos)
+    {
+      break;
+    }
+  }
+
+  std::smatch match;
+  if (std::regex_search(buf, match, std::regex("\\x1b\\[\\?" + std::to_string(mode_) + ";([0-4])\\$y")))
+  {
+    state_ = std::stoi(match[1]);
+  }
+  else
+  {
+    state_ = 0;
+  }
+
+  // keep the keys pressed while waiting
+  input_ += std::regex_replace(buf, std::regex("\\x1b\\[\\?[0-9]+;[0-9]\\$y|\\x1b\\[\\?[0-9;]*c"), "");
+
+  return res;
+}
+
 template<typename T>
 std::string wrap(T const val_, std::string const attr_, bool color_ = true)
 {
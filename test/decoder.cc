@@ -0,0 +1,236 @@
+// round trip tests of the decoders,
+// text compressed by each library is decompressed in pieces and compared with the original
+//
+// usage: test_decoder gzip|xz|zstd
+// exits with 77, counted as skipped, when support for the type was not built in
+
+#include "fltrdr/decoder.hh"
+
+#if defined(FLTRDR_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(FLTRDR_LZMA)
+#include <lzma.h>
+#endif
+
+#if defined(FLTRDR_ZSTD)
+#include <zstd.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <iostream>
+
+namespace
+{
+
+std::mt19937 rng {12345};
+
+// number of failed checks
+std::size_t failed {0};
+
+std::size_t rand(std::size_t const n)
+{
+  return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+}
+
+void check(std::string_view const test, bool const ok)
+{
+  if (! ok)
+  {
+    ++failed;
+    std::cerr << test << ": failed\n";
+  }
+}
+
+// lines of words, many times the size of the pieces the output is produced in
+std::string text(std::size_t const size)
+{
+  std::vector<std::string_view> const words {"he", "said", "the", "end.", "of", "it", "Chapter", "xyzzy"};
+  std::string res;
+
+  while (res.size() < size)
+  {
+    res += words[rand(words.size())];
+    res += rand(8) ? " " : "\n";
+  }
+
+  return res;
+}
+
+// str compressed as a single stream of the type, empty if it is not supported
+std::string compress(Decoder::Type const type, std::string const& str)
+{
+  std::string res;
+
+  switch (type)
+  {
+#if defined(FLTRDR_ZLIB)
+    case Decoder::Type::gzip:
+    {
+      z_stream strm {};
+
+      if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      {
+        break;
+      }
+
+      res.resize(deflateBound(&strm, static_cast<uLong>(str.size())));
+      strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(str.data()));
+      strm.avail_in = static_cast<uInt>(str.size());
+      strm.next_out = reinterpret_cast<Bytef*>(res.data());
+      strm.avail_out = static_cast<uInt>(res.size());
+
+      auto const ec = deflate(&strm, Z_FINISH);
+      res.resize(ec == Z_STREAM_END ? strm.total_out : 0);
+      deflateEnd(&strm);
+
+      break;
+    }
+#endif
+
+#if defined(FLTRDR_LZMA)
+    case Decoder::Type::xz:
+    {
+      std::size_t size {0};
+      res.resize(lzma_stream_buffer_bound(str.size()));
+
+      auto const ec = lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr,
+        reinterpret_cast<std::uint8_t const*>(str.data()), str.size(),
+        reinterpret_cast<std::uint8_t*>(res.data()), &size, res.size());
+      res.resize(ec == LZMA_OK ? size : 0);
+
+      break;
+    }
+#endif
+
+#if defined(FLTRDR_ZSTD)
+    case Decoder::Type::zstd:
+    {
+      res.resize(ZSTD_compressBound(str.size()));
+
+      auto const size = ZSTD_compress(res.data(), res.size(), str.data(), str.size(), 3);
+      res.resize(ZSTD_isError(size) ? 0 : size);
+
+      break;
+    }
+#endif
+
+    default:
+      break;
+  }
+
+  return res;
+}
+
+// decompress data written in random pieces,
+// returns false if a write or the finish fails
+bool decompress(Decoder::Type const type, std::string_view const data, std::string& out)
+{
+  Decoder decoder;
+
+  if (! decoder.init(type))
+  {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < data.size();)
+  {
+    auto const size = std::min(data.size() - i, 1 + rand(1 << 14));
+
+    if (! decoder.write(data.substr(i, size), out))
+    {
+      return false;
+    }
+
+    i += size;
+  }
+
+  return decoder.finish(out);
+}
+
+void test_type(Decoder::Type const type)
+{
+  auto const str = text(std::size_t {1} << 20);
+  auto const data = compress(type, str);
+  check("compress", ! data.empty());
+
+  check("detect", Decoder::detect(data.substr(0, Decoder::magic_size)) == type);
+
+  // a single stream
+  {
+    std::string out;
+    check("round trip", decompress(type, data, out) && out == str);
+  }
+
+  // streams one after another, as when compressed files are concatenated
+  {
+    auto const next = text(1 << 16);
+    std::string out;
+    check("concatenated", decompress(type, data + compress(type, next), out) && out == str + next);
+  }
+
+  // a stream cut short
+  {
+    std::string out;
+    check("truncated", ! decompress(type, std::string_view(data).substr(0, data.size() / 2), out));
+  }
+
+  // a stream with corrupt bytes in the middle
+  {
+    auto bad = data;
+
+    for (std::size_t i = 0; i < 16; ++i)
+    {
+      bad[data.size() / 2 + i] = static_cast<char>(~bad[data.size() / 2 + i]);
+    }
+
+    std::string out;
+    check("corrupt", ! decompress(type, bad, out) || out != str);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  std::string_view const name {argc > 1 ? argv[1] : ""};
+
+  auto const type =
+    name == "gzip" ? Decoder::Type::gzip :
+    name == "xz" ? Decoder::Type::xz :
+    name == "zstd" ? Decoder::Type::zstd :
+    Decoder::Type::none;
+
+  if (type == Decoder::Type::none)
+  {
+    std::cerr << "usage: test_decoder gzip|xz|zstd\n";
+
+    return EXIT_FAILURE;
+  }
+
+  if (! Decoder::supported(type))
+  {
+    std::cout << name << " support was not built in\n";
+
+    return 77;
+  }
+
+  test_type(type);
+
+  if (failed)
+  {
+    std::cerr << failed << " failed\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+// tests of the inverted word index,
+// its postings are those of a scan of the words,
+// and a cache file that does not hold a consistent index is rejected
+
+#include "fltrdr/lexicon.hh"
+#include "fltrdr/text.hh"
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <iterator>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::mt19937 rng {12345};
+
+// number of failed checks
+std::size_t failed {0};
+
+std::size_t rand(std::size_t const n)
+{
+  return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+}
+
+void check(std::string_view const test, bool const ok)
+{
+  if (! ok)
+  {
+    ++failed;
+    std::cerr << test << ": failed\n";
+  }
+}
+
+// lines of words, some differing only in case and punctuation
+std::string text(std::size_t const size)
+{
+  std::vector<std::string_view> const words {"he", "He", "said", "said,", "the", "end.", "(of", "it", "Chapter", "--", "longerthanthewidthofaword"};
+  std::string res;
+
+  while (res.size() < size)
+  {
+    res += words[rand(words.size())];
+    res += rand(8) ? " " : "\n";
+  }
+
+  return res;
+}
+
+std::string read(std::string const& path)
+{
+  std::ifstream file {path, std::ios::binary};
+
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+void write(std::string const& path, std::string const& str)
+{
+  std::ofstream file {path, std::ios::binary | std::ios::trunc};
+  file << str;
+}
+
+std::uint64_t get(std::string const& buf, std::size_t const off)
+{
+  std::uint64_t val;
+  std::memcpy(&val, buf.data() + off, sizeof(val));
+
+  return val;
+}
+
+void set(std::string& buf, std::size_t const off, std::uint64_t const val)
+{
+  std::memcpy(buf.data() + off, &val, sizeof(val));
+}
+
+// indices of the words equal to word once normalized, found by a scan
+std::vector<std::size_t> scan(Text const& text, std::string_view const word)
+{
+  std::vector<std::size_t> res;
+
+  for (std::size_t i = 0; i < text.size(); ++i)
+  {
+    if (Lexicon::normalize(text.word(i)) == word)
+    {
+      res.emplace_back(i);
+    }
+  }
+
+  return res;
+}
+
+void test_find(Text const& text, Lexicon const& lexicon, std::string_view const name)
+{
+  for (auto const word : {"he", "said", "end", "of", "chapter", "longerthan", "--", "missing"})
+  {
+    auto const expected = scan(text, word);
+
+    check(name, lexicon.find(word) == expected);
+    check(name, lexicon.count(word) == expected.size());
+  }
+}
+
+// layout of the cache file, from the header in lexicon.hh
+struct Layout
+{
+  static constexpr std::size_t total {24};
+  static constexpr std::size_t entries {32};
+  static constexpr std::size_t keys {40};
+  static constexpr std::size_t postings {48};
+  static constexpr std::size_t entry {56};
+  static constexpr std::size_t entry_size {24};
+};
+
+void test_cache(fs::path const& dir)
+{
+  auto const path = (dir / "text.words").string();
+  std::uint64_t const key {0x1234};
+
+  auto const str = text(std::size_t {1} << 18);
+
+  Text text;
+  text.assign(str);
+  text.index();
+
+  Lexicon lexicon;
+  lexicon.build(text);
+  check("built", lexicon.built() && lexicon.total() == text.size());
+  test_find(text, lexicon, "find");
+
+  lexicon.save(path, key);
+  auto const good = read(path);
+
+  // the saved index is loaded back for the same key only
+  {
+    Lexicon loaded;
+    check("load", loaded.load(path, key));
+    test_find(text, loaded, "loaded find");
+    check("key", ! loaded.load(path, key + 1) && ! loaded.built());
+  }
+
+  auto const entries = get(good, Layout::entries);
+  auto const entry = [&](std::size_t const i, std::size_t const field) {
+    return Layout::entry + i * Layout::entry_size + field * 8;
+  };
+
+  // each corruption of the cache file is rejected when loaded
+  auto const rejected = [&](std::string_view const name, auto const& corrupt) {
+    auto bad = good;
+    corrupt(bad);
+    write(path, bad);
+
+    Lexicon loaded;
+    check(name, ! loaded.load(path, key) && ! loaded.built());
+  };
+
+  rejected("truncated", [&](std::string& buf) { buf.resize(buf.size() - 1); });
+  rejected("magic", [&](std::string& buf) { buf[0] = 'x'; });
+  rejected("no entries", [&](std::string& buf) { set(buf, Layout::entries, 0); });
+
+  // entries whose size in bytes overflows to that of the saved entries
+  rejected("entries overflow", [&](std::string& buf) { set(buf, Layout::entries, entries + (std::uint64_t {1} << 61)); });
+
+  rejected("keys size", [&](std::string& buf) { set(buf, Layout::keys, ~std::uint64_t {0}); });
+  rejected("key past the end", [&](std::string& buf) { set(buf, entry(1, 0), get(buf, Layout::keys) + 1); });
+  rejected("keys out of order", [&](std::string& buf) { set(buf, entry(2, 0), get(buf, entry(1, 0)) - 1); });
+  rejected("keys not sorted", [&](std::string& buf) {
+    auto const keys = Layout::entry + entries * Layout::entry_size;
+    std::swap(buf[keys], buf[keys + get(buf, entry(entries - 2, 0))]);
+  });
+  rejected("postings past the end", [&](std::string& buf) { set(buf, entry(1, 1), get(buf, Layout::postings) + 1); });
+  rejected("postings out of order", [&](std::string& buf) { set(buf, entry(2, 1), get(buf, entry(1, 1)) - 1); });
+  rejected("end entry", [&](std::string& buf) { set(buf, entry(entries - 1, 1), 0); });
+  rejected("no count", [&](std::string& buf) { set(buf, entry(0, 2), 0); });
+  rejected("count", [&](std::string& buf) { set(buf, entry(0, 2), ~std::uint64_t {0}); });
+  rejected("total", [&](std::string& buf) { set(buf, Layout::total, 1); });
+
+  // postings that are not valid varints or run past the words indexed,
+  // within offsets that are, decode to increasing indices of the words indexed
+  {
+    auto bad = good;
+    auto const postings = bad.size() - get(bad, Layout::postings);
+    std::fill(bad.begin() + static_cast<std::ptrdiff_t>(postings), bad.end(), static_cast<char>(0xff));
+
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+      bad[postings + rand(bad.size() - postings)] = static_cast<char>(rand(256));
+    }
+
+    write(path, bad);
+
+    Lexicon loaded;
+    check("bad postings", loaded.load(path, key));
+
+    for (auto const word : {"he", "said", "end", "of", "chapter"})
+    {
+      auto const res = loaded.find(word);
+
+      for (std::size_t i = 0; i < res.size(); ++i)
+      {
+        check("bad postings range", res[i] < text.size() && (i == 0 || res[i] > res[i - 1]));
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  std::error_code ec;
+  auto const dir = fs::temp_directory_path() / ("fltrdr-test-" + std::to_string(getpid()));
+  fs::create_directories(dir, ec);
+
+  test_cache(dir);
+
+  fs::remove_all(dir, ec);
+
+  if (failed)
+  {
+    std::cerr << failed << " failed\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,697 @@
+// differential tests of the pattern engines,
+// the matches of each compiled pattern are compared with those of std::regex,
+// those of sets of strings with a naive search,
+// and those of fuzzy words with the edit distance of each word
+
+#include "fltrdr/pattern.hh"
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <iostream>
+
+namespace
+{
+
+using Matches = std::vector<std::pair<std::size_t, std::size_t>>;
+
+std::mt19937 rng {12345};
+
+// number of failed checks
+std::size_t failed {0};
+
+std::size_t rand(std::size_t const n)
+{
+  return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+}
+
+// text with newlines shown as '~'
+std::string show(std::string_view const str)
+{
+  std::string res {str};
+
+  for (auto& c : res)
+  {
+    if (c == '\n')
+    {
+      c = '~';
+    }
+  }
+
+  return res;
+}
+
+std::string show(Matches const& matches)
+{
+  std::string res;
+
+  for (auto const& [begin, end] : matches)
+  {
+    res += " " + std::to_string(begin) + "-" + std::to_string(end);
+  }
+
+  return res;
+}
+
+void fail(std::string_view const test, std::string const& rx, std::string const& str,
+  Matches const& lhs, Matches const& rhs)
+{
+  if (++failed <= 20)
+  {
+    std::cerr
+    << test << ": /" << rx << "/ on [" << show(str) << "]\n"
+    << "  got:" << show(lhs) << "\n"
+    << "  expected:" << show(rhs) << "\n";
+  }
+}
+
+bool is_space(char const c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool is_punct(char const c)
+{
+  return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+// lowercase copy of str
+std::string lower(std::string_view const str)
+{
+  std::string res {str};
+
+  for (auto& c : res)
+  {
+    if (c >= 'A' && c <= 'Z')
+    {
+      c = static_cast<char>(c + 32);
+    }
+  }
+
+  return res;
+}
+
+// copy of str with each run of whitespace made a single space,
+// and the offsets in str each char of it starts and ends at
+std::string collapse(std::string_view const str, Matches& offsets)
+{
+  std::string res;
+  offsets.clear();
+
+  for (std::size_t i = 0; i < str.size(); ++i)
+  {
+    if (! is_space(str[i]))
+    {
+      res += str[i];
+      offsets.emplace_back(i, i + 1);
+    }
+    else if (i && is_space(str[i - 1]))
+    {
+      offsets.back().second = i + 1;
+    }
+    else
+    {
+      res += ' ';
+      offsets.emplace_back(i, i + 1);
+    }
+  }
+
+  return res;
+}
+
+// number of chars of a collapsed string starting before offset pos of the string,
+// a run of whitespace started before pos being one of them
+std::size_t skip(Matches const& offsets, std::size_t const pos)
+{
+  return static_cast<std::size_t>(std::count_if(offsets.begin(), offsets.end(),
+    [&](auto const& e) { return e.first < pos; }));
+}
+
+// matches found from offset pos, each search starting where the last match ended
+Matches matches(Pattern& pattern, std::string_view const str, std::size_t const pos)
+{
+  Matches res;
+  Pattern::Match match;
+
+  for (auto i = pos; pattern.find(str, i, match); i = match.end)
+  {
+    res.emplace_back(match.begin, match.end);
+  }
+
+  return res;
+}
+
+// the same matches found by std::regex in str with each run of whitespace made a single space,
+// throws std::regex_error if rx is invalid
+Matches reference(std::string const& rx, std::string const& str, std::size_t const pos)
+{
+  Matches res;
+  Matches offsets;
+  auto const text = collapse(str, offsets);
+  auto const first = skip(offsets, pos);
+  std::regex const re {rx, std::regex::ECMAScript | std::regex::icase};
+
+  auto flags = std::regex_constants::match_not_null;
+  if (first)
+  {
+    flags |= std::regex_constants::match_prev_avail;
+  }
+
+  for (auto it = std::cregex_iterator(text.data() + first, text.data() + text.size(), re, flags);
+    it != std::cregex_iterator(); ++it)
+  {
+    auto const begin = first + static_cast<std::size_t>(it->position());
+    res.emplace_back(offsets.at(begin).first, offsets.at(begin + static_cast<std::size_t>(it->length()) - 1).second);
+  }
+
+  return res;
+}
+
+// compare the matches of a compiled pattern in str from offset pos with the expected ones,
+// and those found with a limit, which must find every match starting before the limit
+void check(std::string_view const test, std::string const& rx, Pattern& pattern,
+  std::string const& str, std::size_t const pos, Matches const& expected)
+{
+  auto const res = matches(pattern, str, pos);
+
+  if (res != expected)
+  {
+    fail(test, rx, str, res, expected);
+
+    return;
+  }
+
+  auto const limit = pos + rand(str.size() - pos + 1);
+  Matches limited;
+  Pattern::Match match;
+
+  for (auto i = pos; pattern.find(str, i, limit, match); i = match.end)
+  {
+    limited.emplace_back(match.begin, match.end);
+  }
+
+  auto const count = static_cast<std::size_t>(std::count_if(res.begin(), res.end(),
+    [&](auto const& e) { return e.first < limit; }));
+
+  if (limited.size() < count || ! std::equal(limited.begin(), limited.end(), res.begin()))
+  {
+    fail(std::string(test) + " limit " + std::to_string(limit), rx, str, limited, res);
+  }
+}
+
+// compare the matches of rx in str from offset pos with those of std::regex
+void compare(std::string_view const test, std::string const& rx, std::string const& str, std::size_t const pos)
+{
+  Matches expected;
+  bool valid {true};
+
+  try
+  {
+    expected = reference(rx, str, pos);
+  }
+  catch (std::regex_error const&)
+  {
+    valid = false;
+  }
+
+  Pattern pattern;
+
+  if (pattern.compile(rx) != valid)
+  {
+    if (++failed <= 20)
+    {
+      std::cerr << test << ": /" << rx << "/ compiles " << ! valid << ", expected " << valid << "\n";
+    }
+
+    return;
+  }
+
+  if (! valid)
+  {
+    return;
+  }
+
+  check(test, rx, pattern, str, pos, expected);
+}
+
+// random pattern, repeats are only applied to atoms that can not match empty,
+// as std::regex does not reject empty iterations of a loop the way ECMAScript does
+std::string pattern(std::size_t const depth, bool& nullable);
+
+std::string atom(std::size_t const depth, bool& nullable)
+{
+  nullable = false;
+
+  switch (rand(16))
+  {
+    case 0: return "a";
+    case 1: return "b";
+    case 2: return "A";
+    case 3: return " ";
+    case 4: return ".";
+    case 5: return "\\.";
+    case 6: return rand(2) ? "x" : "\\n";
+    case 7: return "[a-c]";
+    case 8: return "[^ab]";
+    case 9: return "\\w";
+    case 10: return "\\s";
+    case 11: return "[Bx. ]";
+    case 12: nullable = true; return rand(2) ? "\\b" : "\\B";
+    case 13: nullable = true; return rand(2) ? "^" : "$";
+    case 14: if (depth < 3) return "(" + pattern(depth + 1, nullable) + ")"; return "c";
+    default: if (depth < 3) return "(?:" + pattern(depth + 1, nullable) + ")"; return "_";
+  }
+}
+
+std::string pattern(std::size_t const depth, bool& nullable)
+{
+  std::string res;
+  nullable = true;
+
+  for (std::size_t i = 0, size = 1 + rand(3); i < size; ++i)
+  {
+    bool empty {false};
+    res += atom(depth, empty);
+
+    if (! empty)
+    {
+      switch (rand(8))
+      {
+        case 0: res += "*"; empty = true; break;
+        case 1: res += "+"; break;
+        case 2: res += "?"; empty = true; break;
+        case 3: res += "{" + std::to_string(rand(3)) + "," + std::to_string(2 + rand(2)) + "}"; empty = res[res.size() - 4] == '0'; break;
+        case 4: res += "{2}"; break;
+        default: break;
+      }
+    }
+
+    nullable = nullable && empty;
+  }
+
+  if (rand(5) == 0)
+  {
+    bool empty {false};
+    res += "|" + pattern(depth + 1, empty);
+    nullable = nullable || empty;
+  }
+
+  return res;
+}
+
+std::string text(std::size_t const size)
+{
+  std::string_view const chars {"abcABx .\n_"};
+  std::string res;
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    res += chars[rand(chars.size())];
+  }
+
+  return res;
+}
+
+void test_random()
+{
+  for (std::size_t n = 0; n < 5000; ++n)
+  {
+    bool nullable {false};
+    auto const rx = pattern(0, nullable);
+    auto const str = text(rand(40));
+
+    compare("random", rx, str, rand(2) ? 0 : rand(str.size() + 1));
+  }
+}
+
+// patterns covering each feature of the engines, with the engine expected to run them
+void test_cases()
+{
+  struct Case
+  {
+    std::string rx;
+    std::string_view engine;
+  };
+
+  std::vector<Case> const cases {
+    // plain text, compared case-insensitively
+    {"the", "literal"},
+    {"THE", "literal"},
+    {"t", "literal"},
+    {"\\.\\.\\.", "literal"},
+
+    // case folding of sets and ranges
+    {"[a-z]+", "dfa"},
+    {"[^A-Z ]+", "dfa"},
+    {"\\x41b", "literal"},
+    {"[T]h[Ee]", "literal"},
+    {"[a-c]X", "dfa"},
+
+    // nullable loops
+    {"(a*)*b", "dfa"},
+    {"(?:a?)+b", "dfa"},
+    {"(a|)+b", "dfa"},
+    {"(?:a*b*)*c", "dfa"},
+    {"x*", "dfa"},
+
+    // anchors and word boundaries
+    {"^the", "dfa"},
+    {"end$", "dfa"},
+    {"^$", "dfa"},
+    {"\\bth", "dfa"},
+    {"he\\b", "dfa"},
+    {"\\Bhe\\B", "dfa"},
+    {"\\b\\w+\\b", "dfa"},
+
+    // repeats and alternation
+    {"a{2,3}", "dfa"},
+    {"(?:ab){2}", "dfa"},
+    {"the|then|there", "dfa"},
+    {"[0-9]{1,3}(?:,[0-9]{3})*", "dfa"},
+
+    // a run of whitespace reads as a single space, such as a line break
+    {"he said", "literal"},
+    {"said\\she", "literal"},
+    {"he[\\t ]said", "literal"},
+    {"he  said", "dfa"},
+    {"a he\\s\\x20said", "dfa"},
+    {" he", "dfa"},
+    {"[ ]he", "dfa"},
+    {"he said\\b", "dfa"},
+    {"said\\s*he", "dfa"},
+    {"said\\s+he", "literal"},
+    {"e {2}", "dfa"},
+    {"e.", "dfa"},
+    {"[^a-z]s", "dfa"},
+    {"d\\ns", "dfa"},
+    {"\\s$", "dfa"},
+
+    // beyond the regular subset, run by std::regex
+    {"(a)\\1", "regex"},
+    {"the(?= end)", "regex"},
+    {"(he) said \\1", "regex"},
+    {"(\\s)\\1", "regex"},
+    {"(e)(?=.s)", "regex"},
+    {"th(?!e)", "regex"},
+    {"\\u0041", "regex"},
+  };
+
+  std::vector<std::string> const texts {
+    "the end",
+    "The theme, then there. THE END",
+    "aab ab b xaabbc aaaaab",
+    "1,234,567 and 12,34 and 999",
+    "hello world\nthe other\tline...",
+    "he said,\nand he\n  said  he\tsaid. He  \r\n said he he",
+    "a he said, a he  said",
+    "the-end s the\nsing yes!",
+    "",
+  };
+
+  for (auto const& [rx, engine] : cases)
+  {
+    Pattern pattern;
+
+    if (! pattern.compile(rx) || pattern.engine() != engine)
+    {
+      ++failed;
+      std::cerr << "engine: /" << rx << "/ runs on " << pattern.engine() << ", expected " << engine << "\n";
+    }
+
+    for (auto const& str : texts)
+    {
+      for (std::size_t pos = 0; pos <= str.size(); pos += 3)
+      {
+        compare("case", rx, str, pos);
+      }
+    }
+  }
+
+  // invalid patterns are rejected
+  for (auto const& rx : {"(", "a)", "[a", "a**", "*a", "a{2,1}"})
+  {
+    compare("invalid", rx, "a", 0);
+  }
+}
+
+// matches of a set of strings found by trying each of them at each end offset,
+// a match being the string ending first, and the longest one ending there,
+// compared with whitespace runs of both made single spaces
+Matches reference(std::vector<std::string> const& strs, std::string const& str, std::size_t const pos)
+{
+  Matches res;
+  Matches offsets;
+  auto const text = lower(collapse(str, offsets));
+
+  std::vector<std::string> keys;
+  for (auto const& e : strs)
+  {
+    Matches unused;
+    keys.emplace_back(lower(collapse(e, unused)));
+  }
+
+  for (std::size_t begin = skip(offsets, pos), end = begin + 1; end <= text.size(); ++end)
+  {
+    std::size_t len {0};
+
+    for (auto const& e : keys)
+    {
+      if (e.size() > len && e.size() <= end - begin && text.compare(end - e.size(), e.size(), e) == 0)
+      {
+        len = e.size();
+      }
+    }
+
+    if (len)
+    {
+      res.emplace_back(offsets.at(end - len).first, offsets.at(end - 1).second);
+      begin = end;
+    }
+  }
+
+  return res;
+}
+
+void test_strings()
+{
+  // a phrase wrapped across lines
+  {
+    Pattern pattern;
+    pattern.compile(std::vector<std::string> {"HE said", "she  said"});
+    check("strings wrapped", "|HE said|she  said", pattern, "he\n  said, she\tsaid", 0, {{0, 9}, {11, 19}});
+  }
+
+  for (std::size_t n = 0; n < 5000; ++n)
+  {
+    std::vector<std::string> strs (1 + rand(4));
+
+    for (auto& e : strs)
+    {
+      e = text(rand(5));
+    }
+
+    auto const str = text(rand(40));
+    auto const pos = rand(2) ? 0 : rand(str.size() + 1);
+
+    std::string rx;
+    for (auto const& e : strs)
+    {
+      rx += "|" + show(e);
+    }
+
+    Pattern pattern;
+    auto const valid = std::any_of(strs.begin(), strs.end(), [](auto const& e) { return ! e.empty(); });
+
+    if (pattern.compile(strs) != valid)
+    {
+      ++failed;
+      std::cerr << "strings: {" << rx << "} compiles " << ! valid << ", expected " << valid << "\n";
+
+      continue;
+    }
+
+    if (valid)
+    {
+      check("strings", rx, pattern, str, pos, reference(strs, str, pos));
+    }
+  }
+}
+
+// edit distance between two strings, ignoring case
+std::size_t distance(std::string const& lhs, std::string const& rhs)
+{
+  auto const a = lower(lhs);
+  auto const b = lower(rhs);
+  std::vector<std::size_t> row (b.size() + 1);
+
+  for (std::size_t j = 0; j <= b.size(); ++j)
+  {
+    row[j] = j;
+  }
+
+  for (std::size_t i = 1; i <= a.size(); ++i)
+  {
+    auto diag = row[0];
+    row[0] = i;
+
+    for (std::size_t j = 1; j <= b.size(); ++j)
+    {
+      auto const next = std::min({row[j] + 1, row[j - 1] + 1, diag + (a[i - 1] != b[j - 1])});
+      diag = row[j];
+      row[j] = next;
+    }
+  }
+
+  return row[b.size()];
+}
+
+// matches of a string within dist edits of the whole words starting from offset pos,
+// found by splitting the text at whitespace, and each word into parts of width chars when not 0,
+// and trimming the punctuation of each word
+Matches reference(std::string const& term, std::size_t const dist, std::size_t const width,
+  std::string const& str, std::size_t const pos)
+{
+  Matches res;
+
+  for (std::size_t begin = 0, end = 0; begin < str.size(); begin = end)
+  {
+    if (is_space(str[begin]))
+    {
+      end = begin + 1;
+
+      continue;
+    }
+
+    for (end = begin; end < str.size() && ! is_space(str[end]) && (! width || end - begin < width);)
+    {
+      ++end;
+    }
+
+    auto first = begin;
+    auto last = end;
+
+    while (first < last && is_punct(str[first]))
+    {
+      ++first;
+    }
+
+    while (last > first && is_punct(str[last - 1]))
+    {
+      --last;
+    }
+
+    if (begin >= pos && first < last && distance(str.substr(first, last - first), term) <= dist)
+    {
+      res.emplace_back(begin, end);
+    }
+  }
+
+  return res;
+}
+
+// copy of str with a few random edits
+std::string edit(std::string str, std::size_t const edits)
+{
+  std::string_view const chars {"abcxAB.-"};
+
+  for (std::size_t i = 0; i < edits; ++i)
+  {
+    auto const at = rand(str.size() + 1);
+
+    switch (rand(3))
+    {
+      case 0: str.insert(at, 1, chars[rand(chars.size())]); break;
+      case 1: if (at < str.size()) str.erase(at, 1); break;
+      default: if (at < str.size()) str[at] = chars[rand(chars.size())]; break;
+    }
+  }
+
+  return str;
+}
+
+void test_fuzzy()
+{
+  std::string_view const spaces {" \n\t  \r"};
+  std::string_view const punct {"\"(.,!'-"};
+
+  for (std::size_t n = 0; n < 5000; ++n)
+  {
+    auto term = edit("", 1 + rand(8));
+    auto const dist = rand(4);
+
+    if (rand(50) == 0)
+    {
+      term = std::string(64 + rand(2), 'a');
+    }
+
+    // words near the term, with punctuation around and within them
+    std::string str;
+
+    for (std::size_t i = 0, size = rand(8); i < size; ++i)
+    {
+      for (std::size_t j = 0, space = rand(3); j < space; ++j)
+      {
+        str += spaces[rand(spaces.size())];
+      }
+
+      if (rand(4) == 0)
+      {
+        str += punct[rand(punct.size())];
+      }
+
+      str += edit(term, rand(dist + 2));
+
+      if (rand(4) == 0)
+      {
+        str += punct[rand(punct.size())];
+      }
+    }
+
+    auto const pos = rand(2) ? 0 : rand(str.size() + 1);
+    auto const width = rand(2) ? 0 : 1 + rand(8);
+    auto const rx = term + "~" + std::to_string(dist) + (width ? "/" + std::to_string(width) : "");
+
+    Pattern pattern;
+    auto const valid = ! term.empty() && dist < term.size() && (! dist || term.size() <= 64) &&
+      std::none_of(term.begin(), term.end(), [](char const c) { return is_space(c); });
+
+    if (pattern.compile(term, dist, width) != valid)
+    {
+      ++failed;
+      std::cerr << "fuzzy: " << rx << " compiles " << ! valid << ", expected " << valid << "\n";
+
+      continue;
+    }
+
+    if (valid)
+    {
+      check("fuzzy", rx, pattern, str, pos, reference(term, dist, width, str, pos));
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  test_cases();
+  test_random();
+  test_strings();
+  test_fuzzy();
+
+  if (failed)
+  {
+    std::cerr << failed << " failed\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,401 @@
+// tests of searching the text through the reader,
+// the text is read in chunks, and the matches found across their joins
+// are compared with those found in the text as a single string
+
+#include "fltrdr/fltrdr.hh"
+#include "fltrdr/pattern.hh"
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <system_error>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::mt19937 rng {12345};
+
+// number of failed checks
+std::size_t failed {0};
+
+std::size_t rand(std::size_t const n)
+{
+  return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+}
+
+// lines of words, with the phrases searched for wrapped across lines,
+// long enough to be read into many chunks
+std::string text(std::size_t const size)
+{
+  std::vector<std::string_view> const words {"he", "said", "she", "the", "end", "of", "it", "Said", "then"};
+  std::string res;
+
+  while (res.size() < size)
+  {
+    res += words[rand(words.size())];
+    res += rand(8) ? " " : rand(2) ? "\n" : "  \n ";
+  }
+
+  return res;
+}
+
+// number of matches of the pattern compiled by compile in str
+template<typename F>
+std::size_t count(std::string_view const str, F const& compile)
+{
+  Pattern pattern;
+  compile(pattern);
+
+  std::size_t res {0};
+  Pattern::Match match;
+
+  for (std::size_t i = 0; pattern.find(str, i, match); i = match.end)
+  {
+    ++res;
+  }
+
+  return res;
+}
+
+// add the text read and the matches found in the background until neither changes
+void settle(Fltrdr& fltrdr)
+{
+  for (std::size_t idle = 0; idle < 50;)
+  {
+    if (fltrdr.update() || fltrdr.searching())
+    {
+      idle = 0;
+    }
+    else
+    {
+      ++idle;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+}
+
+void check(std::string_view const test, std::string const& name, std::size_t const res, std::size_t const expected)
+{
+  if (res != expected)
+  {
+    ++failed;
+    std::cerr << test << ": " << name << " has " << res << " matches, expected " << expected << "\n";
+  }
+}
+
+std::vector<std::string> const patterns {
+  "he said",
+  "said\\s+he",
+  "the end of",
+  "(she) said \\1",
+  "\\bit\\s*\\n",
+  "d\\s+s",
+};
+
+std::vector<std::string> const strs {"he said", "then\nshe", "of"};
+
+// text parsed from an input stream
+void test_parse()
+{
+  auto const str = text(1 << 21);
+
+  Fltrdr fltrdr;
+  std::istringstream input {str};
+  fltrdr.parse(input);
+
+  for (auto const& rx : patterns)
+  {
+    fltrdr.search_forward(rx);
+    settle(fltrdr);
+    check("parse", rx, fltrdr.search_density(1).at(0), count(str, [&](Pattern& p) { return p.compile(rx); }));
+  }
+
+  fltrdr.search_set(strs);
+  settle(fltrdr);
+  check("parse", "set", fltrdr.search_density(1).at(0), count(str, [&](Pattern& p) { return p.compile(strs); }));
+}
+
+// stream str to the reader through a pipe, written in random pieces,
+// returns the writer, which is not joinable if there is no pipe
+std::thread stream(Fltrdr& fltrdr, std::string const& str)
+{
+  int fd[2];
+  if (pipe(fd) != 0)
+  {
+    ++failed;
+    std::cerr << "stream: no pipe\n";
+
+    return {};
+  }
+
+  // started first, as the reader waits for the words of the first frame
+  std::thread writer {[&str, fd = fd[1]] {
+    std::mt19937 gen {1};
+
+    for (std::size_t i = 0; i < str.size();)
+    {
+      auto const size = std::min(str.size() - i, std::size_t {1} + gen() % (1 << 15));
+
+      if (write(fd, str.data() + i, size) <= 0)
+      {
+        break;
+      }
+
+      i += size;
+    }
+
+    close(fd);
+  }};
+
+  fltrdr.stream(fd[0]);
+
+  return writer;
+}
+
+// text streamed from a pipe while it is searched
+void test_stream()
+{
+  auto const str = text(1 << 21);
+
+  Fltrdr fltrdr;
+  auto writer = stream(fltrdr, str);
+
+  if (! writer.joinable())
+  {
+    return;
+  }
+
+  fltrdr.search_forward(patterns.front());
+  settle(fltrdr);
+  writer.join();
+  settle(fltrdr);
+
+  check("stream", patterns.front(), fltrdr.search_density(1).at(0),
+    count(str, [&](Pattern& p) { return p.compile(patterns.front()); }));
+}
+
+// text wrapped across lines is searched as if its words were separated by single spaces
+void test_wrapped()
+{
+  Fltrdr fltrdr;
+  std::istringstream input {"the-end s the\nsing yes!"};
+  fltrdr.parse(input);
+
+  fltrdr.search_forward("e.");
+  settle(fltrdr);
+  check("wrapped", "e.", fltrdr.search_density(1).at(0), 4);
+
+  // the next match after the first word is the one ending in the line break
+  fltrdr.set_index(1);
+  fltrdr.search_next();
+
+  if (fltrdr.get_index() != 3)
+  {
+    ++failed;
+    std::cerr << "wrapped: next match at word " << fltrdr.get_index() << ", expected 3\n";
+  }
+}
+
+// number of matches of the search once settled, and the words stepped through to them from the first word
+void walk(Fltrdr& fltrdr, std::string const& name, std::vector<std::string>& res)
+{
+  settle(fltrdr);
+  res.emplace_back(name + ": " + std::to_string(fltrdr.search_density(1).at(0)));
+
+  fltrdr.set_index(1);
+
+  for (std::size_t prev {0}; fltrdr.get_index() != prev;)
+  {
+    prev = fltrdr.get_index();
+    fltrdr.search_next();
+    fltrdr.set_line();
+    res.emplace_back(std::to_string(fltrdr.get_index()) + " " + fltrdr.word());
+  }
+}
+
+// words read at random jumps through the text and on from each,
+// and for each search its number of matches and the words the matches are in
+std::vector<std::string> visit(Fltrdr& fltrdr)
+{
+  std::vector<std::string> res;
+  std::mt19937 gen {2};
+
+  fltrdr.screen_size(80, 24);
+  fltrdr.end();
+  auto const size = fltrdr.get_index();
+  res.emplace_back(std::to_string(size));
+
+  for (std::size_t i = 0; i < 100; ++i)
+  {
+    fltrdr.set_index(1 + gen() % size);
+
+    for (std::size_t j = 0; j < 50; ++j)
+    {
+      fltrdr.set_line();
+      res.emplace_back(fltrdr.word());
+      fltrdr.next_word();
+    }
+  }
+
+  for (auto const rx : {"zebra", "zebra crossing", "zebr[a-z]+\\b"})
+  {
+    fltrdr.search_forward(rx);
+    walk(fltrdr, rx, res);
+  }
+
+  return res;
+}
+
+// a word search finds the same words with the word index as without it,
+// where words longer than the max width are split into words of that width
+void test_word_index()
+{
+  std::vector<std::string_view> const words {"he", "He,", "(he)", "said", "said--he", "aword", "Aword.",
+    "longerthanthewidthofaword", "xyzzyxyzzyxyzzyxyzzyhe", "hehehehehehehehehehehe...he", "--"};
+  std::string str;
+
+  while (str.size() < (1 << 20))
+  {
+    str += words[rand(words.size())];
+    str += rand(8) ? " " : "\n";
+  }
+
+  std::vector<std::string> res[2];
+
+  for (auto const indexed : {false, true})
+  {
+    Fltrdr fltrdr;
+    fltrdr.screen_size(80, 24);
+    fltrdr.set_word_index(indexed);
+
+    std::istringstream input {str};
+    fltrdr.parse(input);
+
+    if (fltrdr.word_count("he").has_value() != indexed)
+    {
+      ++failed;
+      std::cerr << "word index: index " << (indexed ? "not built" : "built") << "\n";
+    }
+
+    for (auto const word : {"he", "HE!", "said", "aword", "longerthanthewidthof", "longerthanthewidthofaword", "xyzzy", "said--he"})
+    {
+      fltrdr.search_word(word, true);
+      walk(fltrdr, word, res[indexed]);
+    }
+  }
+
+  if (res[0] != res[1])
+  {
+    ++failed;
+    std::cerr << "word index: the search without the index finds other words\n";
+  }
+}
+
+// text larger than the budget, read through a window that releases the text outside of it,
+// from a mapped file and from a stream kept in a spill file,
+// reads and searches the same as without a budget
+void test_budget()
+{
+  std::error_code ec;
+  auto const dir = fs::temp_directory_path() / ("fltrdr-test-" + std::to_string(getpid()));
+  fs::create_directories(dir, ec);
+
+  // the cache files and the spill file go in the test directory
+  setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+
+  // rare words to search for among the common ones
+  auto str = text(std::size_t {5} << 25);
+
+  for (std::size_t i = 0; i < 500; ++i)
+  {
+    auto const pos = str.find(' ', rand(str.size()));
+
+    if (pos != std::string::npos)
+    {
+      str.replace(pos, 1, rand(2) ? " zebra " : " zebra\ncrossing ");
+    }
+  }
+
+  auto const path = (dir / "budget.txt").string();
+  {
+    std::ofstream file {path, std::ios::binary | std::ios::trunc};
+    file << str;
+  }
+
+  std::size_t const budget {std::size_t {1} << 27};
+
+  std::vector<std::string> expected;
+  {
+    Fltrdr fltrdr;
+    auto writer = stream(fltrdr, str);
+    settle(fltrdr);
+    writer.join();
+    settle(fltrdr);
+    expected = visit(fltrdr);
+  }
+
+  {
+    Fltrdr fltrdr;
+    fltrdr.set_budget(budget);
+    fltrdr.open(path);
+    settle(fltrdr);
+
+    if (visit(fltrdr) != expected)
+    {
+      ++failed;
+      std::cerr << "budget: the mapped file reads differently\n";
+    }
+  }
+
+  {
+    Fltrdr fltrdr;
+    fltrdr.set_budget(budget);
+    auto writer = stream(fltrdr, str);
+    settle(fltrdr);
+    writer.join();
+    settle(fltrdr);
+
+    if (visit(fltrdr) != expected)
+    {
+      ++failed;
+      std::cerr << "budget: the spilled stream reads differently\n";
+    }
+  }
+
+  fs::remove_all(dir, ec);
+}
+
+} // namespace
+
+int main()
+{
+  test_parse();
+  test_stream();
+  test_wrapped();
+  test_word_index();
+  test_budget();
+
+  if (failed)
+  {
+    std::cerr << failed << " failed\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+// tests of the word index cache,
+// a cache file saved for a file is loaded back only while the file is unchanged
+
+#include "fltrdr/text.hh"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::mt19937 rng {12345};
+
+// number of failed checks
+std::size_t failed {0};
+
+std::size_t rand(std::size_t const n)
+{
+  return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+}
+
+void check(std::string_view const test, bool const ok)
+{
+  if (! ok)
+  {
+    ++failed;
+    std::cerr << test << ": failed\n";
+  }
+}
+
+// lines of words, larger than the min size of a cached file
+std::string text(std::size_t const size)
+{
+  std::vector<std::string_view> const words {"he", "said", "the", "end.", "of", "it", "Chapter", "longerthanthewidthofaword"};
+  std::string res;
+
+  while (res.size() < size)
+  {
+    res += words[rand(words.size())];
+    res += rand(8) ? " " : "\n";
+  }
+
+  return res;
+}
+
+void write(std::string const& path, std::string const& str)
+{
+  std::ofstream file {path, std::ios::binary | std::ios::trunc};
+  file << str;
+}
+
+// text positions of the words, and the sentence ends
+std::vector<std::size_t> words(Text& text)
+{
+  std::vector<std::size_t> res;
+
+  for (std::size_t i = 0; i < text.size(); ++i)
+  {
+    res.emplace_back(text.pos(i));
+  }
+
+  auto const& sentences = text.sentences();
+  res.insert(res.end(), sentences.begin(), sentences.end());
+
+  return res;
+}
+
+void test_cache(fs::path const& dir)
+{
+  auto const path = (dir / "text.txt").string();
+  auto const cache = (dir / "text.idx").string();
+  auto str = text(std::size_t {3} << 20);
+  write(path, str);
+
+  // index the file and save its cache file
+  std::vector<std::size_t> expected;
+  {
+    Text text;
+    check("map", text.map(path));
+    check("no cache", ! text.load(cache));
+    text.index();
+    expected = words(text);
+    text.save(cache);
+  }
+
+  // the cache file of the unchanged file is loaded
+  {
+    Text text;
+    text.map(path);
+    check("load", text.load(cache));
+    check("loaded words", words(text) == expected);
+  }
+
+  // a cache file for another word width is not
+  {
+    Text text;
+    text.set_width(10);
+    text.map(path);
+    check("width", ! text.load(cache));
+  }
+
+  // an edit in the middle of the file that keeps its size and modification time
+  // moves the words, so the cache file is stale
+  {
+    struct stat st;
+    stat(path.c_str(), &st);
+
+    auto const mid = str.find(' ', str.size() / 2);
+    str[mid] = 'x';
+    str[mid + 1] = ' ';
+    write(path, str);
+
+    struct timespec const times[] {st.st_atim, st.st_mtim};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+
+    Text text;
+    text.map(path);
+    check("stale", ! text.load(cache));
+    text.index();
+    check("stale words", words(text) != expected);
+  }
+
+  // a truncated cache file is rejected
+  {
+    Text text;
+    text.map(path);
+    text.index();
+    text.save(cache);
+
+    fs::resize_file(cache, fs::file_size(cache) / 2);
+
+    Text loaded;
+    loaded.map(path);
+    check("truncated", ! loaded.load(cache));
+  }
+}
+
+} // namespace
+
+int main()
+{
+  std::error_code ec;
+  auto const dir = fs::temp_directory_path() / ("fltrdr-test-" + std::to_string(getpid()));
+  fs::create_directories(dir, ec);
+
+  test_cache(dir);
+
+  fs::remove_all(dir, ec);
+
+  if (failed)
+  {
+    std::cerr << failed << " failed\n";
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}